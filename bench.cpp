@@ -0,0 +1,489 @@
+#include "hash_table.hpp"
+#include "columnar_hash_table.hpp"
+#include "cuckoo_hash_table.hpp"
+#include "frozen_hash_table.hpp"
+#include "large_array_allocator.hpp"
+#include "key_hash.hpp"
+#include "spill_hash_table.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+	typedef std::chrono::steady_clock Clock;
+
+	double seconds_since(Clock::time_point start) {
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	// keys like "key" + i share their first bytes, which the bucket hash of HT puts into the lowest
+	// bits, so a million of them land in a few thousand buckets with chains of hundreds of cells.
+	// Keys starting with the hex of a mixed counter spread over the buckets evenly
+	Key make_key(size_t i, const std::string& suffix = "key") {
+		char hex[17];
+		std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(mix_hash(i)));
+		return hex + suffix;
+	}
+
+	void fill(HashTable& HT, size_t n) {
+		for (size_t i = 0; i < n; ++i)
+			HT.insert(make_key(i), Value("name", static_cast<unsigned int>(i)));
+	}
+
+	// time of a single rehash of n keys into twice as many buckets, for different amounts of workers
+	void bench_rehash(size_t n) {
+		std::cout << "rehash of " << n << " keys\n";
+		for (size_t threads : { 1, 2, 4, 8, 16, 32 }) {
+			HashTable HT;
+			HT.set_parallel_rehash(threads > 1 ? 1 : 0, threads);
+			fill(HT, n);
+			auto start = Clock::now();
+			HT.reserve(n * 2);
+			std::cout << "  threads " << threads << ": " << seconds_since(start) << " s\n";
+		}
+	}
+
+	std::vector<std::pair<Key, Value>> make_entries(size_t n, const std::string& prefix) {
+		std::vector<std::pair<Key, Value>> entries;
+		entries.reserve(n);
+		for (size_t i = 0; i < n; ++i)
+			entries.emplace_back(make_key(i, prefix), Value("name", static_cast<unsigned int>(i)));
+		return entries;
+	}
+
+	// bulk build by insert against build_from, and combining two tables by insert against merge
+	void bench_build_and_merge(size_t n) {
+		std::vector<std::pair<Key, Value>> entries = make_entries(n, "key");
+		std::cout << "build of " << n << " keys\n";
+		{
+			auto start = Clock::now();
+			HashTable HT;
+			for (const auto& [key, val] : entries)
+				HT.insert(key, val);
+			std::cout << "  insert: " << seconds_since(start) << " s\n";
+		}
+		for (size_t threads : { 1, 2, 4, 8, 16, 32 }) {
+			auto start = Clock::now();
+			HashTable HT = HashTable::build_from(entries, threads);
+			std::cout << "  build_from, threads " << threads << ": " << seconds_since(start) << " s\n";
+		}
+
+		std::vector<std::pair<Key, Value>> other = make_entries(n, "other");
+		std::cout << "combining two tables of " << n << " keys\n";
+		{
+			HashTable A = HashTable::build_from(entries);
+			HashTable B = HashTable::build_from(other);
+			auto start = Clock::now();
+			for (const auto& [key, val] : other)
+				A.insert(key, B.at(key));
+			std::cout << "  insert: " << seconds_since(start) << " s\n";
+		}
+		{
+			HashTable A = HashTable::build_from(entries);
+			HashTable B = HashTable::build_from(other);
+			auto start = Clock::now();
+			A.merge(std::move(B));
+			std::cout << "  merge: " << seconds_since(start) << " s\n";
+		}
+	}
+
+	// draws ranks from 0 to n - 1, rank r is drawn with probability proportional to 1 / (r + 1)^s
+	class Zipf {
+	public:
+		Zipf(size_t n, double s) : _cdf(n) {
+			double sum = 0;
+			for (size_t r = 0; r < n; ++r)
+				_cdf[r] = (sum += 1.0 / std::pow(static_cast<double>(r + 1), s));
+			for (double& x : _cdf)
+				x /= sum;
+		}
+
+		size_t operator()(std::mt19937_64& gen) {
+			double x = std::uniform_real_distribution<double>(0, 1)(gen);
+			return std::min<size_t>(std::lower_bound(_cdf.begin(), _cdf.end(), x) - _cdf.begin(), _cdf.size() - 1);
+		}
+	private:
+		std::vector<double> _cdf;
+	};
+
+	// HT as a cache in front of a slow store: a miss inserts the key, the capacity evicts cold keys
+	void bench_cache(size_t n) {
+		const size_t universe = n;
+		std::vector<Key> keys;
+		keys.reserve(universe);
+		for (size_t i = 0; i < universe; ++i)
+			keys.push_back(make_key(i));
+		std::mt19937_64 gen(42);
+		Zipf zipf(universe, 0.99);
+		std::vector<size_t> trace(n * 4);
+		for (auto& rank : trace)
+			rank = zipf(gen);
+
+		std::cout << "zipfian cache over " << universe << " keys, " << trace.size() << " lookups\n";
+		for (size_t percent : { 1, 5, 10, 25 }) {
+			HashTable HT;
+			HT.set_capacity(universe * percent / 100);
+			size_t hits = 0;
+			auto start = Clock::now();
+			for (size_t rank : trace) {
+				if (HT.contains(keys[rank]))
+					++hits;
+				else
+					HT.insert(keys[rank], Value("name", static_cast<unsigned int>(rank)));
+			}
+			double time = seconds_since(start);
+			std::cout << "  capacity " << percent << "%: hit rate " << 100.0 * hits / trace.size()
+				<< "%, " << trace.size() / time << " ops/s\n";
+		}
+	}
+
+	// build time, lookup throughput and bytes per entry of the frozen HT against the mutable one
+	void bench_frozen(size_t n) {
+		std::vector<Key> keys;
+		for (size_t i = 0; i < n; ++i)
+			keys.push_back(make_key(i));
+		std::mt19937_64 gen(42);
+		std::vector<size_t> trace(n * 4);
+		for (auto& id : trace)
+			id = gen() % n;
+
+		auto start = Clock::now();
+		HashTable HT;
+		for (size_t i = 0; i < n; ++i)
+			HT.insert(keys[i], Value("name", static_cast<unsigned int>(i)));
+		double build = seconds_since(start);
+		size_t bytes = HT.memory_usage();
+		size_t found = 0;
+		start = Clock::now();
+		for (size_t id : trace)
+			found += HT.contains(keys[id]);
+		double lookup = seconds_since(start);
+		std::cout << "mutable HT of " << n << " keys: build " << build << " s, " << trace.size() / lookup
+			<< " lookups/s, " << static_cast<double>(bytes) / n << " bytes per entry\n";
+
+		start = Clock::now();
+		FrozenHashTable F(HT);
+		build = seconds_since(start);
+		bytes = F.memory_usage();
+		start = Clock::now();
+		for (size_t id : trace)
+			found += F.contains(keys[id]);
+		lookup = seconds_since(start);
+		std::cout << "frozen HT of " << n << " keys: build " << build << " s, " << trace.size() / lookup
+			<< " lookups/s, " << static_cast<double>(bytes) / n << " bytes per entry\n";
+		if (found != 2 * trace.size())
+			std::cout << "  lost keys!\n";
+	}
+
+	// contains at 90% misses with and without the filter
+	void bench_filter(size_t n) {
+		std::vector<Key> keys;
+		for (size_t i = 0; i < n; ++i)
+			keys.push_back(make_key(i));
+		std::mt19937_64 gen(42);
+		std::vector<Key> trace(n * 4);
+		for (size_t i = 0; i < trace.size(); ++i)
+			trace[i] = i % 10 ? make_key(gen() % n, "miss") : keys[gen() % n];
+
+		std::cout << "contains at 90% misses over " << n << " keys\n";
+		for (double fp_rate : { 0.0, 0.1, 0.01, 0.001 }) {
+			HashTable HT;
+			HT.set_filter(fp_rate);
+			for (size_t i = 0; i < n; ++i)
+				HT.insert(keys[i], Value("name", static_cast<unsigned int>(i)));
+			size_t found = 0;
+			auto start = Clock::now();
+			for (const Key& key : trace)
+				found += HT.contains(key);
+			double time = seconds_since(start);
+			std::cout << "  fp rate " << fp_rate << ": " << trace.size() / time << " ops/s, " << found << " hits\n";
+		}
+	}
+
+	// lookups one by one against interleaved lookups with different amounts of lookups in flight
+	void bench_interleaved(size_t n) {
+		std::vector<Key> keys;
+		for (size_t i = 0; i < n; ++i)
+			keys.push_back(make_key(i));
+		HashTable HT = HashTable::build_from(make_entries(n, "key"));
+		std::mt19937_64 gen(42);
+		std::vector<Key> trace(n * 4);
+		for (auto& key : trace)
+			key = keys[gen() % n];
+
+		HashTable::ChainStats chains = HT.chain_stats();
+		std::cout << "lookups of " << trace.size() << " keys in HT of " << n << " keys, longest chain "
+			<< chains.longest << ", " << chains.compares_per_hit << " compares per hit\n";
+		size_t found = 0;
+		auto start = Clock::now();
+		for (const Key& key : trace)
+			found += HT.contains(key);
+		std::cout << "  contains: " << trace.size() / seconds_since(start) << " ops/s\n";
+		for (size_t group_size : { 1, 2, 4, 8, 16, 32, 64 }) {
+			start = Clock::now();
+			std::vector<const Value*> values = HT.find_interleaved(trace, group_size);
+			double time = seconds_since(start);
+			found += std::count(values.begin(), values.end(), nullptr);
+			std::cout << "  interleaved, group " << group_size << ": " << trace.size() / time << " ops/s\n";
+		}
+		if (found != trace.size())
+			std::cout << "  lost keys!\n";
+	}
+
+	// random lookups over a table much larger than the TLB reach. "pages" and "hugepages" differ
+	// only in the memory policy, so that each can be run alone under perf stat -e dTLB-load-misses
+	void bench_lookups_with_policy(size_t n, bool huge_pages) {
+		MemoryPolicy policy;
+		policy.huge_pages = huge_pages;
+		set_memory_policy(policy);
+		HashTable HT = HashTable::build_from(make_entries(n, "key"));
+		FrozenHashTable F(HT);
+		std::vector<Key> keys;
+		std::mt19937_64 gen(42);
+		for (size_t i = 0; i < n; ++i)
+			keys.push_back(make_key(gen() % n));
+
+		std::cout << (huge_pages ? "huge" : "ordinary") << " pages, " << n << " keys\n";
+		size_t found = 0;
+		auto start = Clock::now();
+		for (const Key& key : keys)
+			found += HT.contains(key);
+		std::cout << "  mutable HT: " << keys.size() / seconds_since(start) << " lookups/s\n";
+		start = Clock::now();
+		for (const Key& key : keys)
+			found += F.contains(key);
+		std::cout << "  frozen HT: " << keys.size() / seconds_since(start) << " lookups/s\n";
+		if (found != 2 * keys.size())
+			std::cout << "  lost keys!\n";
+		set_memory_policy(MemoryPolicy());
+	}
+
+	void bench_pages(size_t n) {
+		bench_lookups_with_policy(n, false);
+	}
+
+	void bench_huge_pages(size_t n) {
+		bench_lookups_with_policy(n, true);
+	}
+
+	// skewed mixed workload over a working set growing past the memory budget of spill HT
+	void bench_spill(size_t n) {
+		const size_t budget = 16 << 20;
+		std::cout << "spill HT, memory budget " << budget << " bytes\n";
+		for (size_t keys : { n / 8, n / 4, n / 2, n }) {
+			SpillHashTable S((std::filesystem::temp_directory_path() / "spill_bench.bin").string(), budget);
+			for (size_t i = 0; i < keys; ++i)
+				S.insert(make_key(i), Value("name" + std::to_string(i), i));
+
+			std::mt19937_64 gen(42);
+			std::uniform_real_distribution<double> uniform;
+			SpillHashTable::Stats before = S.stats();
+			size_t ops = keys, found = 0;
+			auto start = Clock::now();
+			for (size_t i = 0; i < ops; ++i) {
+				// a quarter of the keys gets 90% of the accesses
+				size_t hot = uniform(gen) < 0.9 ? keys / 4 : keys;
+				Key key = make_key(gen() % std::max<size_t>(hot, 1));
+				if (i % 4 == 0)
+					S.insert(key, Value("updated", i));
+				else
+					found += S.contains(key);
+			}
+			double time = seconds_since(start);
+			SpillHashTable::Stats after = S.stats();
+			std::cout << "  " << keys << " keys, " << S.resident_bytes() << " bytes resident: "
+				<< ops / time << " ops/s, "
+				<< double(after.bytes_read - before.bytes_read) / ops << " bytes read/op, "
+				<< double(after.bytes_written - before.bytes_written) / ops << " bytes written/op\n";
+			if (found != ops - (ops + 3) / 4)
+				std::cout << "  lost keys!\n";
+		}
+	}
+
+	// cost of taking a snapshot against a deep copy, and the writer slowdown while snapshots are alive
+	void bench_snapshot(size_t n) {
+		HashTable HT = HashTable::build_from(make_entries(n, "key"));
+		std::vector<Key> keys;
+		std::mt19937_64 gen(42);
+		for (size_t i = 0; i < n; ++i)
+			keys.push_back(make_key(gen() % n));
+
+		std::cout << "snapshots of HT of " << n << " keys\n";
+		auto start = Clock::now();
+		HashTable copy = HT;
+		std::cout << "  deep copy: " << seconds_since(start) * 1e6 << " us\n";
+		start = Clock::now();
+		const size_t snapshots = 1000;
+		for (size_t i = 0; i < snapshots; ++i)
+			HT.snapshot();
+		std::cout << "  snapshot: " << seconds_since(start) * 1e6 / snapshots << " us\n";
+
+		// every mode overwrites the same keys, so the storage is never resized
+		auto write = [&HT, &keys](const char* mode, size_t snapshot_every, bool read) {
+			HashTable::Snapshot S = HT.snapshot();
+			std::atomic<bool> done{ false };
+			std::atomic<size_t> reads{ 0 };
+			std::thread reader;
+			if (read) {
+				reader = std::thread([&S, &keys, &done, &reads] {
+					for (size_t i = 0; !done; i = (i + 1) % keys.size()) {
+						S.contains(keys[i]);
+						++reads;
+					}
+				});
+			}
+			auto start = Clock::now();
+			for (size_t i = 0; i < keys.size(); ++i) {
+				if (snapshot_every && (i % snapshot_every == 0))
+					S = HT.snapshot();
+				HT.insert(keys[i], Value("updated", i));
+			}
+			double time = seconds_since(start);
+			done = true;
+			if (reader.joinable())
+				reader.join();
+			std::cout << "  writes, " << mode << ": " << keys.size() / time << " ops/s";
+			if (read)
+				std::cout << ", " << reads / time << " snapshot reads/s";
+			std::cout << "\n";
+		};
+		auto start_plain = Clock::now();
+		for (size_t i = 0; i < keys.size(); ++i)
+			HT.insert(keys[i], Value("updated", i));
+		std::cout << "  writes, no snapshot: " << keys.size() / seconds_since(start_plain) << " ops/s\n";
+		write("one snapshot", 0, false);
+		write("new snapshot every 1000 writes", 1000, false);
+		write("one snapshot read by another thread", 0, true);
+	}
+
+	// reading ages only: the cells of HT against the tag, key and age columns of columnar HT
+	void bench_columnar(size_t n) {
+		HashTable HT = HashTable::build_from(make_entries(n, "key"));
+		// frozen HT hashes keys the same way as columnar HT, but keeps whole cells in its slots
+		FrozenHashTable F(HT);
+		ColumnarHashTable C(HT);
+		std::vector<Key> keys;
+		std::mt19937_64 gen(42);
+		for (size_t i = 0; i < n; ++i)
+			keys.push_back(make_key(gen() % n));
+
+		std::cout << "ages of " << n << " keys\n";
+		uint64_t sums[3] = {};
+		auto start = Clock::now();
+		for (const Key& key : keys)
+			sums[0] += HT.at(key).age;
+		std::cout << "  HT lookups: " << keys.size() / seconds_since(start) << " ops/s\n";
+		start = Clock::now();
+		for (const Key& key : keys)
+			sums[1] += F.at(key).age;
+		std::cout << "  frozen HT lookups: " << keys.size() / seconds_since(start) << " ops/s\n";
+		start = Clock::now();
+		for (const Key& key : keys)
+			sums[2] += C.age(key);
+		std::cout << "  columnar HT lookups: " << keys.size() / seconds_since(start) << " ops/s\n";
+
+		const size_t scans = 20;
+		uint64_t scanned[2] = {};
+		start = Clock::now();
+		for (size_t i = 0; i < scans; ++i)
+			HT.for_each([&scanned](const Key&, const Value& v) { scanned[0] += v.age; });
+		std::cout << "  HT sum of ages: " << scans * n / seconds_since(start) << " cells/s\n";
+		start = Clock::now();
+		for (size_t i = 0; i < scans; ++i)
+			scanned[1] += C.sum_ages();
+		std::cout << "  columnar HT sum of ages: " << scans * n / seconds_since(start) << " cells/s\n";
+
+		size_t counted[2] = {};
+		start = Clock::now();
+		for (size_t i = 0; i < scans; ++i)
+			HT.for_each([&counted, n](const Key&, const Value& v) { counted[0] += v.age < n / 2; });
+		std::cout << "  HT count of ages: " << scans * n / seconds_since(start) << " cells/s\n";
+		start = Clock::now();
+		for (size_t i = 0; i < scans; ++i)
+			counted[1] += C.count_ages(0, n / 2 - 1);
+		std::cout << "  columnar HT count of ages: " << scans * n / seconds_since(start) << " cells/s\n";
+		if ((sums[0] != sums[1]) || (sums[0] != sums[2]) || (scanned[0] != scanned[1]) || (counted[0] != counted[1]))
+			std::cout << "  results differ!\n";
+	}
+
+	// cuckoo HT is filled in steps of 10% of its capacity until the first failed search doubles
+	// the storage. Every step reports the insert throughput and the lookup latency at its load
+	void bench_cuckoo(size_t n) {
+		for (size_t slots : { 4, 8 }) {
+			CuckooHashTable C(slots);
+			C.reserve(n);
+			size_t capacity = C.capacity();
+			std::vector<Key> keys;
+			for (size_t i = 0; i < capacity; ++i)
+				keys.push_back(make_key(i));
+
+			std::cout << "cuckoo HT, " << slots << " slots in a bucket, " << capacity << " slots\n";
+			std::mt19937_64 gen(42);
+			size_t inserted = 0;
+			for (size_t step = 1; (step <= 10) && (C.capacity() == capacity); ++step) {
+				size_t last = std::min(capacity * step / 10, keys.size());
+				auto start = Clock::now();
+				for (; (inserted < last) && (C.capacity() == capacity); ++inserted)
+					C.insert(keys[inserted], Value("name", inserted));
+				double insert_time = seconds_since(start);
+				if (C.capacity() != capacity)
+					break;
+				size_t step_keys = inserted - capacity * (step - 1) / 10;
+
+				const size_t lookups = 1000000;
+				size_t found = 0;
+				start = Clock::now();
+				for (size_t i = 0; i < lookups; ++i)
+					found += C.contains(keys[gen() % inserted]);
+				double lookup_time = seconds_since(start);
+				std::cout << "  load " << C.load_factor() << ": " << step_keys / insert_time << " inserts/s, "
+					<< lookup_time * 1e9 / lookups << " ns/lookup\n";
+				if (found != lookups)
+					std::cout << "  lost keys!\n";
+			}
+			if (C.capacity() != capacity)
+				std::cout << "  storage doubled after " << inserted << " keys, load "
+					<< static_cast<double>(inserted - 1) / capacity << "\n";
+		}
+	}
+
+	struct Bench {
+		const char* name;
+		void (*run)(size_t);
+	};
+
+	const Bench BENCHES[] = {
+		{ "rehash", bench_rehash },
+		{ "build", bench_build_and_merge },
+		{ "cache", bench_cache },
+		{ "frozen", bench_frozen },
+		{ "filter", bench_filter },
+		{ "interleaved", bench_interleaved },
+		{ "pages", bench_pages },
+		{ "hugepages", bench_huge_pages },
+		{ "spill", bench_spill },
+		{ "snapshot", bench_snapshot },
+		{ "columnar", bench_columnar },
+		{ "cuckoo", bench_cuckoo },
+	};
+}
+
+// usage: HashTableBench [keys amount] [bench name]. Configure with -DCMAKE_BUILD_TYPE=Release for meaningful numbers
+int main(int argc, char** argv) {
+	size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+	std::string only = argc > 2 ? argv[2] : "";
+	for (const Bench& bench : BENCHES) {
+		if (only.empty() || only == bench.name)
+			bench.run(n);
+	}
+	return 0;
+}
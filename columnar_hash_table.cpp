@@ -0,0 +1,179 @@
+#include "columnar_hash_table.hpp"
+#include "key_hash.hpp"
+#include <stdexcept>
+#include <utility>
+
+ColumnarHashTable::ColumnarHashTable() : _tags(INITIAL_CAPACITY, TAG_FREE), _keys(INITIAL_CAPACITY),
+	_ages(INITIAL_CAPACITY, 0), _names(INITIAL_CAPACITY) {}
+
+ColumnarHashTable::ColumnarHashTable(const HashTable& table) : ColumnarHashTable() {
+	size_t new_size = INITIAL_CAPACITY;
+	while (table.size() * MAX_LOAD_DENOMINATOR >= new_size * MAX_LOAD_NUMERATOR)
+		new_size *= 2;
+	resize_storage(new_size);
+	table.for_each([this](const Key& k, const Value& v) { insert(k, v); });
+}
+
+// the slot is taken from the low bits of the hash and the tag from the highest ones
+size_t ColumnarHashTable::find(const Key& k) const {
+	uint64_t hash = calc_key_hash(k);
+	uint8_t tag = calc_tag(hash);
+	size_t mask = _tags.size() - 1;
+	for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+		if (_tags[slot] == TAG_FREE)
+			return SIZE_MAX;
+		if ((_tags[slot] == tag) && (_keys[slot] == k))
+			return slot;
+	}
+}
+
+size_t ColumnarHashTable::find_or_throw(const Key& k) const {
+	size_t slot = find(k);
+	if (slot == SIZE_MAX)
+		throw std::out_of_range("at threw to you \"out of range\"-exception");
+	return slot;
+}
+
+// erased slots are dropped, since every cell is placed anew
+void ColumnarHashTable::resize_storage(size_t new_size) {
+	auto old_tags = std::move(_tags);
+	auto old_keys = std::move(_keys);
+	auto old_ages = std::move(_ages);
+	auto old_names = std::move(_names);
+	_tags.assign(new_size, TAG_FREE);
+	_keys.assign(new_size, Key());
+	_ages.assign(new_size, 0);
+	_names.assign(new_size, std::string());
+	_erased = 0;
+
+	size_t mask = new_size - 1;
+	for (size_t i = 0; i < old_tags.size(); ++i) {
+		if (!(old_tags[i] & TAG_USED))
+			continue;
+		uint64_t hash = calc_key_hash(old_keys[i]);
+		size_t slot = hash & mask;
+		while (_tags[slot] != TAG_FREE)
+			slot = (slot + 1) & mask;
+		_tags[slot] = calc_tag(hash);
+		_keys[slot] = std::move(old_keys[i]);
+		_ages[slot] = old_ages[i];
+		_names[slot] = std::move(old_names[i]);
+	}
+}
+
+bool ColumnarHashTable::insert(const Key& k, const Value& v) {
+	size_t slot = find(k);
+	if (slot != SIZE_MAX) {
+		_ages[slot] = v.age;
+		_names[slot] = v.name;
+		return false;
+	}
+
+	// when erased slots take most of the load, the storage is rebuilt without growing
+	if ((_size + _erased + 1) * MAX_LOAD_DENOMINATOR >= _tags.size() * MAX_LOAD_NUMERATOR) {
+		size_t new_size = _tags.size();
+		if ((_size + 1) * MAX_LOAD_DENOMINATOR * 2 >= new_size * MAX_LOAD_NUMERATOR)
+			new_size *= 2;
+		resize_storage(new_size);
+	}
+
+	uint64_t hash = calc_key_hash(k);
+	size_t mask = _tags.size() - 1;
+	slot = hash & mask;
+	while (_tags[slot] & TAG_USED)
+		slot = (slot + 1) & mask;
+	if (_tags[slot] == ERASED)
+		--_erased;
+	_tags[slot] = calc_tag(hash);
+	_keys[slot] = k;
+	_ages[slot] = v.age;
+	_names[slot] = v.name;
+	++_size;
+	return true;
+}
+
+// the slot is marked as erased rather than empty, so that the probe sequences going through it stay intact
+bool ColumnarHashTable::erase(const Key& k) {
+	size_t slot = find(k);
+	if (slot == SIZE_MAX)
+		return false;
+	_tags[slot] = ERASED;
+	_keys[slot].clear();
+	_ages[slot] = 0;
+	_names[slot].clear();
+	--_size;
+	++_erased;
+	return true;
+}
+
+bool ColumnarHashTable::contains(const Key& k) const {
+	return find(k) != SIZE_MAX;
+}
+
+Value ColumnarHashTable::at(const Key& k) const {
+	size_t slot = find_or_throw(k);
+	return Value(_names[slot], _ages[slot]);
+}
+
+unsigned int ColumnarHashTable::age(const Key& k) const {
+	return _ages[find_or_throw(k)];
+}
+
+const std::string& ColumnarHashTable::name(const Key& k) const {
+	return _names[find_or_throw(k)];
+}
+
+void ColumnarHashTable::set_age(const Key& k, unsigned int age) {
+	_ages[find_or_throw(k)] = age;
+}
+
+void ColumnarHashTable::set_name(const Key& k, const std::string& name) {
+	_names[find_or_throw(k)] = name;
+}
+
+uint64_t ColumnarHashTable::sum_ages() const {
+	const unsigned int* ages = _ages.data();
+	uint64_t sum = 0;
+	for (size_t i = 0; i < _ages.size(); ++i)
+		sum += ages[i];
+	return sum;
+}
+
+// the loops below have no branches, so that they are vectorized
+size_t ColumnarHashTable::count_ages(unsigned int a, unsigned int b) const {
+	if (a > b)
+		return 0;
+	const uint8_t* tags = _tags.data();
+	const unsigned int* ages = _ages.data();
+	unsigned int width = b - a;
+	size_t count = 0;
+	for (size_t i = 0; i < _ages.size(); ++i)
+		count += (tags[i] >> 7) & static_cast<unsigned int>(ages[i] - a <= width);
+	return count;
+}
+
+std::vector<Key> ColumnarHashTable::keys_by_age(unsigned int a, unsigned int b) const {
+	std::vector<Key> result;
+	if (a > b)
+		return result;
+	// the mask is computed by a vectorized pass, and only the keys it selects are read
+	std::vector<uint8_t> mask(_ages.size());
+	const uint8_t* tags = _tags.data();
+	const unsigned int* ages = _ages.data();
+	unsigned int width = b - a;
+	for (size_t i = 0; i < mask.size(); ++i)
+		mask[i] = (tags[i] >> 7) & static_cast<uint8_t>(ages[i] - a <= width);
+	for (size_t i = 0; i < mask.size(); ++i) {
+		if (mask[i])
+			result.push_back(_keys[i]);
+	}
+	return result;
+}
+
+size_t ColumnarHashTable::size() const {
+	return _size;
+}
+
+bool ColumnarHashTable::empty() const {
+	return _size == 0;
+}
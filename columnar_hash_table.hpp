@@ -0,0 +1,72 @@
+#pragma once
+#include "hash_table.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// HT with open addressing which stores every field of the cells in its own array indexed by slot.
+// Lookups probe a dense array of one-byte tags and compare only the keys whose tag matches,
+// so names and ages never get into the cache unless they are asked for. Scans over ages read
+// the age column alone and are written so that the compiler vectorizes them
+class ColumnarHashTable {
+public:
+	// creates an empty columnar HT
+	ColumnarHashTable();
+
+	// copies all the cells of HT, except expired ones. Later changes of HT don't affect columnar HT
+	explicit ColumnarHashTable(const HashTable& table);
+
+	// the same as in HT
+	bool insert(const Key& k, const Value& v);
+	bool erase(const Key& k);
+	bool contains(const Key& k) const;
+
+	// returns a copy of the value put together from the columns, or throws a std::out_of_range
+	// exception if columnar HT doesn't contain the key. The same holds for the accessors below,
+	// which read only their own column
+	Value at(const Key& k) const;
+	unsigned int age(const Key& k) const;
+	const std::string& name(const Key& k) const;
+
+	void set_age(const Key& k, unsigned int age);
+	void set_name(const Key& k, const std::string& name);
+
+	// returns the sum of ages of all cells
+	uint64_t sum_ages() const;
+
+	// returns the amount of cells with age from a to b inclusive
+	size_t count_ages(unsigned int a, unsigned int b) const;
+
+	// returns keys of all cells with age from a to b inclusive, in no particular order
+	std::vector<Key> keys_by_age(unsigned int a, unsigned int b) const;
+
+	// returns an actual amount of keys contained in columnar HT
+	size_t size() const;
+
+	// returns false if columnar HT size doesn't equal 0. If it does, returns true
+	bool empty() const;
+private:
+	static constexpr size_t INITIAL_CAPACITY = 16;
+	// the storage is doubled when used and erased slots together take more than 7/8 of it
+	static constexpr size_t MAX_LOAD_NUMERATOR = 7;
+	static constexpr size_t MAX_LOAD_DENOMINATOR = 8;
+
+	// tag of an erased slot, which is not used but doesn't end a probe either
+	static constexpr uint8_t ERASED = 1;
+
+	size_t _size = 0;
+	size_t _erased = 0;
+
+	// ages of free slots are kept equal to 0, so that sum_ages needs no tags
+	std::vector<uint8_t, LargeArrayAllocator<uint8_t>> _tags;
+	std::vector<Key, LargeArrayAllocator<Key>> _keys;
+	std::vector<unsigned int, LargeArrayAllocator<unsigned int>> _ages;
+	std::vector<std::string, LargeArrayAllocator<std::string>> _names;
+
+	// returns the slot of the key or SIZE_MAX if columnar HT doesn't contain it
+	size_t find(const Key& k) const;
+
+	size_t find_or_throw(const Key& k) const;
+
+	void resize_storage(size_t new_size);
+};
@@ -0,0 +1,74 @@
+#include "counting_bloom_filter.hpp"
+#include <algorithm>
+#include <cmath>
+
+CountingBloomFilter::CountingBloomFilter() {}
+
+// the amount of counters per key and of probes are taken from the classic Bloom filter formulas.
+// Keys are spread over the blocks unevenly, so a blocked filter is sized for a twice lower rate
+CountingBloomFilter::CountingBloomFilter(size_t expected_keys, double fp_rate) {
+	fp_rate = std::min(std::max(fp_rate, 1e-6), 0.5) / 2;
+	double counters_per_key = -std::log(fp_rate) / (std::log(2.0) * std::log(2.0));
+	_probes = std::min<size_t>(std::max<size_t>(std::lround(counters_per_key * std::log(2.0)), 1), MAX_PROBES);
+	double counters = std::ceil(std::max<size_t>(expected_keys, 1) * counters_per_key);
+	_blocks.resize(static_cast<size_t>(std::ceil(counters / COUNTERS_PER_BLOCK)));
+}
+
+CountingBloomFilter::Block& CountingBloomFilter::block_of(uint64_t hash) {
+	return _blocks[static_cast<size_t>(((hash >> 32) * _blocks.size()) >> 32)];
+}
+
+const CountingBloomFilter::Block& CountingBloomFilter::block_of(uint64_t hash) const {
+	return _blocks[static_cast<size_t>(((hash >> 32) * _blocks.size()) >> 32)];
+}
+
+// double hashing inside the block by the lower half of the hash, the upper half chooses the block
+size_t CountingBloomFilter::counter_of(uint64_t hash, size_t probe) {
+	uint32_t a = static_cast<uint32_t>(hash);
+	uint32_t b = (a >> 16) | (a << 16) | 1;
+	return (a + probe * b) % COUNTERS_PER_BLOCK;
+}
+
+void CountingBloomFilter::add(uint64_t hash) {
+	if (!enabled())
+		return;
+	Block& block = block_of(hash);
+	for (size_t i = 0; i < _probes; ++i) {
+		size_t counter = counter_of(hash, i);
+		uint64_t& word = block.words[counter / COUNTERS_PER_WORD];
+		size_t shift = (counter % COUNTERS_PER_WORD) * COUNTER_BITS;
+		if (((word >> shift) & COUNTER_MAX) != COUNTER_MAX)
+			word += uint64_t(1) << shift;
+	}
+}
+
+void CountingBloomFilter::remove(uint64_t hash) {
+	if (!enabled())
+		return;
+	Block& block = block_of(hash);
+	for (size_t i = 0; i < _probes; ++i) {
+		size_t counter = counter_of(hash, i);
+		uint64_t& word = block.words[counter / COUNTERS_PER_WORD];
+		size_t shift = (counter % COUNTERS_PER_WORD) * COUNTER_BITS;
+		uint64_t value = (word >> shift) & COUNTER_MAX;
+		if ((value != 0) && (value != COUNTER_MAX))
+			word -= uint64_t(1) << shift;
+	}
+}
+
+bool CountingBloomFilter::may_contain(uint64_t hash) const {
+	if (!enabled())
+		return true;
+	const Block& block = block_of(hash);
+	for (size_t i = 0; i < _probes; ++i) {
+		size_t counter = counter_of(hash, i);
+		uint64_t word = block.words[counter / COUNTERS_PER_WORD];
+		if (((word >> ((counter % COUNTERS_PER_WORD) * COUNTER_BITS)) & COUNTER_MAX) == 0)
+			return false;
+	}
+	return true;
+}
+
+bool CountingBloomFilter::enabled() const {
+	return !_blocks.empty();
+}
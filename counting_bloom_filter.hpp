@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Bloom filter of 4-bit counters, so that keys can be removed as well as added.
+// All counters of a key lie in one 64-byte block, so every query reads one cache line.
+// Works with 64-bit hashes of keys, which must be evenly distributed
+class CountingBloomFilter {
+public:
+	// creates a disabled filter, which may contain everything
+	CountingBloomFilter();
+
+	// creates a filter for up to expected_keys keys with approximately fp_rate false positives
+	CountingBloomFilter(size_t expected_keys, double fp_rate);
+
+	void add(uint64_t hash);
+
+	// the hash must have been added before. Counters which overflowed are never decremented,
+	// so such filter can't give a false negative but may give more false positives
+	void remove(uint64_t hash);
+
+	// false if the key was definitely never added (or was removed), true otherwise
+	bool may_contain(uint64_t hash) const;
+
+	// true unless the filter is disabled
+	bool enabled() const;
+private:
+	static constexpr size_t COUNTER_BITS = 4;
+	static constexpr uint64_t COUNTER_MAX = (1 << COUNTER_BITS) - 1;
+	static constexpr size_t COUNTERS_PER_WORD = 64 / COUNTER_BITS;
+	static constexpr size_t WORDS_PER_BLOCK = 8;
+	static constexpr size_t COUNTERS_PER_BLOCK = COUNTERS_PER_WORD * WORDS_PER_BLOCK;
+	static constexpr size_t MAX_PROBES = 16;
+
+	struct alignas(64) Block {
+		uint64_t words[WORDS_PER_BLOCK] = {};
+	};
+
+	size_t _probes = 0;
+	std::vector<Block> _blocks;
+
+	Block& block_of(uint64_t hash);
+	const Block& block_of(uint64_t hash) const;
+
+	static size_t counter_of(uint64_t hash, size_t probe);
+};
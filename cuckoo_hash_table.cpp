@@ -0,0 +1,228 @@
+#include "cuckoo_hash_table.hpp"
+#include "key_hash.hpp"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+CuckooHashTable::Cell::Cell() : val("") {}
+
+CuckooHashTable::CuckooHashTable(size_t bucket_slots) : _bucket_slots(bucket_slots),
+	_buckets(INITIAL_BUCKETS), _cells(INITIAL_BUCKETS * bucket_slots) {
+	if ((bucket_slots < 4) || (bucket_slots > MAX_BUCKET_SLOTS))
+		throw std::invalid_argument("cuckoo HT needs from 4 to 8 slots in a bucket");
+}
+
+// both buckets are taken from the bits of the hash below the tag, so that they are independent
+size_t CuckooHashTable::first_bucket(uint64_t hash) const {
+	return hash & (_buckets.size() - 1);
+}
+
+size_t CuckooHashTable::second_bucket(uint64_t hash) const {
+	size_t bucket = (hash >> 24) & (_buckets.size() - 1);
+	return bucket == first_bucket(hash) ? bucket ^ 1 : bucket;
+}
+
+CuckooHashTable::Cell* CuckooHashTable::find(const Key& k) const {
+	uint64_t hash = calc_key_hash(k);
+	uint8_t tag = calc_tag(hash);
+	for (size_t bucket : { first_bucket(hash), second_bucket(hash) }) {
+		const Bucket& b = _buckets[bucket];
+		for (size_t slot = 0; slot < _bucket_slots; ++slot) {
+			const Cell& c = _cells[bucket * _bucket_slots + slot];
+			if ((b.tags[slot] == tag) && (c.key == k))
+				return const_cast<Cell*>(&c);
+		}
+	}
+	return nullptr;
+}
+
+bool CuckooHashTable::on_path(const std::vector<Step>& steps, size_t step, size_t bucket, size_t slot) {
+	for (size_t i = step; steps[i].parent != SIZE_MAX; i = steps[i].parent) {
+		if ((steps[steps[i].parent].bucket == bucket) && (steps[i].slot == slot))
+			return true;
+	}
+	return false;
+}
+
+// the search visits buckets in the order of their distance from the buckets of the key. Once
+// a bucket with a free slot is found, the cells of the path are moved starting from its end,
+// so that every move fills the slot freed by the previous one
+bool CuckooHashTable::place(Cell&& cell) {
+	std::vector<Step> steps;
+	steps.push_back({ first_bucket(cell.hash), SIZE_MAX, 0 });
+	steps.push_back({ second_bucket(cell.hash), SIZE_MAX, 0 });
+
+	for (size_t i = 0; i < steps.size(); ++i) {
+		size_t bucket = steps[i].bucket;
+		uint8_t* tags = _buckets[bucket].tags;
+		size_t free_slot = std::find(tags, tags + _bucket_slots, TAG_FREE) - tags;
+		if (free_slot == _bucket_slots) {
+			if (steps.size() >= MAX_SEARCH_BUCKETS)
+				continue;
+			for (size_t slot = 0; slot < _bucket_slots; ++slot) {
+				if (on_path(steps, i, bucket, slot))
+					continue;
+				uint64_t hash = _cells[bucket * _bucket_slots + slot].hash;
+				size_t other = first_bucket(hash) == bucket ? second_bucket(hash) : first_bucket(hash);
+				steps.push_back({ other, i, slot });
+			}
+			continue;
+		}
+
+		for (size_t j = i; steps[j].parent != SIZE_MAX; j = steps[j].parent) {
+			const Step& step = steps[j];
+			size_t from = steps[step.parent].bucket;
+			_cells[step.bucket * _bucket_slots + free_slot] = std::move(_cells[from * _bucket_slots + step.slot]);
+			_buckets[step.bucket].tags[free_slot] = _buckets[from].tags[step.slot];
+			free_slot = step.slot;
+			bucket = from;
+		}
+		_buckets[bucket].tags[free_slot] = calc_tag(cell.hash);
+		_cells[bucket * _bucket_slots + free_slot] = std::move(cell);
+		return true;
+	}
+	return false;
+}
+
+void CuckooHashTable::take_cells(std::vector<Cell>& cells) {
+	for (size_t bucket = 0; bucket < _buckets.size(); ++bucket) {
+		for (size_t slot = 0; slot < _bucket_slots; ++slot) {
+			if (_buckets[bucket].tags[slot] != TAG_FREE)
+				cells.push_back(std::move(_cells[bucket * _bucket_slots + slot]));
+		}
+	}
+}
+
+void CuckooHashTable::resize_storage(size_t new_buckets) {
+	std::vector<Cell> cells;
+	cells.reserve(_size);
+	take_cells(cells);
+
+	while (true) {
+		_buckets.assign(new_buckets, Bucket());
+		_cells.assign(new_buckets * _bucket_slots, Cell());
+		size_t placed = 0;
+		while ((placed < cells.size()) && place(std::move(cells[placed])))
+			++placed;
+		if (placed == cells.size())
+			return;
+
+		std::vector<Cell> rest(std::make_move_iterator(cells.begin() + placed), std::make_move_iterator(cells.end()));
+		take_cells(rest);
+		cells = std::move(rest);
+		new_buckets *= 2;
+	}
+}
+
+void CuckooHashTable::swap(CuckooHashTable& b) {
+	std::swap(_size, b._size);
+	std::swap(_bucket_slots, b._bucket_slots);
+	_buckets.swap(b._buckets);
+	_cells.swap(b._cells);
+}
+
+void CuckooHashTable::clear() {
+	_buckets.assign(INITIAL_BUCKETS, Bucket());
+	_cells.assign(INITIAL_BUCKETS * _bucket_slots, Cell());
+	_size = 0;
+}
+
+bool CuckooHashTable::erase(const Key& k) {
+	Cell* c = find(k);
+	if (!c)
+		return false;
+
+	size_t id = c - _cells.data();
+	_buckets[id / _bucket_slots].tags[id % _bucket_slots] = TAG_FREE;
+	*c = Cell();
+	--_size;
+
+	if ((_buckets.size() > INITIAL_BUCKETS) && (_size * SHRINK_COEF < capacity()))
+		resize_storage(_buckets.size() / 2);
+	return true;
+}
+
+bool CuckooHashTable::insert(const Key& k, const Value& v) {
+	Cell* c = find(k);
+	if (c) {
+		c->val = v;
+		return false;
+	}
+
+	Cell cell;
+	cell.key = k;
+	cell.val = v;
+	cell.hash = calc_key_hash(k);
+	while (!place(std::move(cell)))
+		resize_storage(_buckets.size() * 2);
+	++_size;
+	return true;
+}
+
+bool CuckooHashTable::contains(const Key& k) const {
+	return find(k) != nullptr;
+}
+
+Value& CuckooHashTable::operator[](const Key& k) {
+	Cell* c = find(k);
+	if (c)
+		return c->val;
+	insert(k, Value(""));
+	return find(k)->val;
+}
+
+Value& CuckooHashTable::at(const Key& k) {
+	return const_cast<Value&>(static_cast<const CuckooHashTable*>(this)->at(k));
+}
+
+const Value& CuckooHashTable::at(const Key& k) const {
+	Cell* c = find(k);
+	if (c == nullptr)
+		throw std::out_of_range("at threw to you \"out of range\"-exception");
+	return c->val;
+}
+
+void CuckooHashTable::reserve(size_t n) {
+	size_t new_buckets = _buckets.size();
+	while (n > new_buckets * _bucket_slots * RESERVE_LOAD)
+		new_buckets *= 2;
+	if (new_buckets != _buckets.size())
+		resize_storage(new_buckets);
+}
+
+size_t CuckooHashTable::size() const {
+	return _size;
+}
+
+bool CuckooHashTable::empty() const {
+	return _size == 0;
+}
+
+size_t CuckooHashTable::capacity() const {
+	return _buckets.size() * _bucket_slots;
+}
+
+double CuckooHashTable::load_factor() const {
+	return static_cast<double>(_size) / capacity();
+}
+
+bool operator==(const CuckooHashTable& a, const CuckooHashTable& b) {
+	if (a._size != b._size)
+		return false;
+	for (size_t bucket = 0; bucket < a._buckets.size(); ++bucket) {
+		for (size_t slot = 0; slot < a._bucket_slots; ++slot) {
+			if (a._buckets[bucket].tags[slot] == TAG_FREE)
+				continue;
+			const CuckooHashTable::Cell& a_cell = a._cells[bucket * a._bucket_slots + slot];
+			const CuckooHashTable::Cell* b_cell = b.find(a_cell.key);
+			if (!b_cell || (b_cell->val.age != a_cell.val.age) || (b_cell->val.name != a_cell.val.name))
+				return false;
+		}
+	}
+	return true;
+}
+
+bool operator!=(const CuckooHashTable& a, const CuckooHashTable& b) {
+	return !(a == b);
+}
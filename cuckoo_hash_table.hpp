@@ -0,0 +1,93 @@
+#pragma once
+#include "hash_table.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// HT with bucketized cuckoo hashing. Every key may be placed only in one of its two buckets of
+// 4 to 8 slots, so a lookup reads the tags of at most two buckets, 8 bytes each, and compares
+// only the keys whose tag matches. A key whose buckets are both full is inserted by moving cells
+// to their other buckets along the shortest path found by breadth-first search. When no path is
+// found, the storage is doubled. Unlike chained HT, it has no capacity, eviction, expiry or indices
+class CuckooHashTable {
+public:
+	static constexpr size_t DEFAULT_BUCKET_SLOTS = 4;
+
+	// creates an empty cuckoo HT with bucket_slots slots in every bucket.
+	// Throws a std::invalid_argument exception if bucket_slots isn't from 4 to 8
+	explicit CuckooHashTable(size_t bucket_slots = DEFAULT_BUCKET_SLOTS);
+
+	// the same as in HT
+	void swap(CuckooHashTable& b);
+	void clear();
+	bool erase(const Key& k);
+	bool insert(const Key& k, const Value& v);
+	bool contains(const Key& k) const;
+	Value& operator[](const Key& k);
+	Value& at(const Key& k);
+	const Value& at(const Key& k) const;
+	void reserve(size_t n);
+	size_t size() const;
+	bool empty() const;
+
+	// returns the amount of slots, used and free
+	size_t capacity() const;
+
+	// returns the share of used slots
+	double load_factor() const;
+
+	friend bool operator==(const CuckooHashTable& a, const CuckooHashTable& b);
+	friend bool operator!=(const CuckooHashTable& a, const CuckooHashTable& b);
+private:
+	static constexpr size_t MAX_BUCKET_SLOTS = 8;
+	static constexpr size_t INITIAL_BUCKETS = 2;
+	// the search stops after queueing that many buckets, which keeps every path within 4-5 moves
+	static constexpr size_t MAX_SEARCH_BUCKETS = 1024;
+	// the storage is halved when less than 1/SHRINK_COEF of the slots are used
+	static constexpr size_t SHRINK_COEF = 8;
+	// reserve leaves that share of the slots free, so that the last inserts find short paths
+	static constexpr double RESERVE_LOAD = 0.9;
+
+	struct Bucket {
+		uint8_t tags[MAX_BUCKET_SLOTS] = {};
+	};
+
+	struct Cell {
+		Key key;
+		Value val;
+		uint64_t hash = 0;
+		Cell();
+	};
+
+	// a bucket visited by the search, and the slot of its parent whose cell would move into it
+	struct Step {
+		size_t bucket;
+		size_t parent;
+		size_t slot;
+	};
+
+	size_t _size = 0;
+	size_t _bucket_slots;
+
+	// tags are kept apart from cells, so that the tags of a bucket take one load
+	std::vector<Bucket, LargeArrayAllocator<Bucket>> _buckets;
+	std::vector<Cell, LargeArrayAllocator<Cell>> _cells;
+
+	size_t first_bucket(uint64_t hash) const;
+
+	size_t second_bucket(uint64_t hash) const;
+
+	Cell* find(const Key& k) const;
+
+	// places a key known to be absent. Returns false if no free slot is reachable
+	bool place(Cell&& cell);
+
+	// checks if the cell in the slot of the bucket is already moved by the path to the step
+	static bool on_path(const std::vector<Step>& steps, size_t step, size_t bucket, size_t slot);
+
+	// moves all the cells out of the storage into cells
+	void take_cells(std::vector<Cell>& cells);
+
+	// doubles new_buckets until all the cells fit
+	void resize_storage(size_t new_buckets);
+};
@@ -0,0 +1,147 @@
+#include "frozen_hash_table.hpp"
+#include "key_hash.hpp"
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+FrozenHashTable::Slot::Slot(const Key& k, const Value& v) : key(k), val(v) {}
+
+FrozenHashTable::FrozenHashTable() {}
+
+size_t FrozenHashTable::calc_bucket(uint64_t hash) const {
+	return static_cast<size_t>((hash >> 32) % _pilots.size());
+}
+
+size_t FrozenHashTable::calc_slot(uint64_t hash, uint32_t pilot) const {
+	return static_cast<size_t>((hash ^ mix_hash(pilot ^ _seed)) % _table_size);
+}
+
+// buckets are placed from the largest to the smallest. Every bucket gets the first pilot
+// which sends all its keys to distinct free slots
+bool FrozenHashTable::place(const std::vector<uint64_t>& hashes, std::vector<size_t>& slot_of) {
+	std::vector<std::vector<size_t>> buckets(_pilots.size());
+	for (size_t i = 0; i < hashes.size(); ++i)
+		buckets[calc_bucket(hashes[i])].push_back(i);
+
+	std::vector<size_t> order(buckets.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(),
+		[&buckets](size_t a, size_t b) { return buckets[a].size() > buckets[b].size(); });
+
+	std::vector<bool> taken(_table_size, false);
+	std::vector<size_t> slots;
+	for (size_t b : order) {
+		if (buckets[b].empty())
+			break;
+		uint32_t pilot = 0;
+		for (; pilot < MAX_PILOT; ++pilot) {
+			slots.clear();
+			for (size_t i : buckets[b]) {
+				size_t slot = calc_slot(hashes[i], pilot);
+				if (taken[slot] || (std::find(slots.begin(), slots.end(), slot) != slots.end()))
+					break;
+				slots.push_back(slot);
+			}
+			if (slots.size() == buckets[b].size())
+				break;
+		}
+		if (pilot == MAX_PILOT)
+			return false;
+
+		_pilots[b] = pilot;
+		for (size_t j = 0; j < slots.size(); ++j) {
+			taken[slots[j]] = true;
+			slot_of[buckets[b][j]] = slots[j];
+		}
+	}
+
+	_remap.assign(_table_size - _size, 0);
+	size_t free_slot = 0;
+	for (size_t slot = _size; slot < _table_size; ++slot) {
+		if (!taken[slot])
+			continue;
+		while (taken[free_slot])
+			++free_slot;
+		_remap[slot - _size] = free_slot++;
+	}
+	for (size_t& slot : slot_of) {
+		if (slot >= _size)
+			slot = _remap[slot - _size];
+	}
+	return true;
+}
+
+FrozenHashTable::FrozenHashTable(const HashTable& table) {
+	std::vector<const HashTable::Cell*> cells;
+	cells.reserve(table._size);
+	HashTable::Clock::time_point now = HashTable::Clock::now();
+	for (const auto list : table._storage) {
+		if (!list)
+			continue;
+		for (const auto& cell : *list) {
+			if (!table._expiry.enabled || (cell.expires > now))
+				cells.push_back(&cell);
+		}
+	}
+	if (cells.empty())
+		return;
+
+	_size = cells.size();
+	_table_size = std::max(_size, static_cast<size_t>(_size / LOAD_FACTOR));
+	_pilots.resize((_size + KEYS_PER_BUCKET - 1) / KEYS_PER_BUCKET);
+
+	std::vector<uint64_t> hashes(_size);
+	std::vector<size_t> slot_of(_size);
+	for (_seed = 0; _seed < MAX_SEEDS; ++_seed) {
+		for (size_t i = 0; i < _size; ++i)
+			hashes[i] = calc_key_hash(cells[i]->key, _seed);
+		if (place(hashes, slot_of))
+			break;
+	}
+	if (_seed == MAX_SEEDS)
+		throw std::runtime_error("FrozenHashTable failed to build a perfect hash");
+
+	std::vector<size_t> cell_of(_size);
+	for (size_t i = 0; i < _size; ++i)
+		cell_of[slot_of[i]] = i;
+	_slots.reserve(_size);
+	for (size_t i : cell_of)
+		_slots.emplace_back(cells[i]->key, cells[i]->val);
+}
+
+const FrozenHashTable::Slot* FrozenHashTable::find(const Key& k) const {
+	if (_size == 0)
+		return nullptr;
+	uint64_t hash = calc_key_hash(k, _seed);
+	size_t id = calc_slot(hash, _pilots[calc_bucket(hash)]);
+	if (id >= _size)
+		id = _remap[id - _size];
+	const Slot& slot = _slots[id];
+	return slot.key == k ? &slot : nullptr;
+}
+
+bool FrozenHashTable::contains(const Key& k) const {
+	return find(k) != nullptr;
+}
+
+const Value& FrozenHashTable::at(const Key& k) const {
+	const Slot* slot = find(k);
+	if (slot == nullptr)
+		throw std::out_of_range("at threw to you \"out of range\"-exception");
+	return slot->val;
+}
+
+size_t FrozenHashTable::memory_usage() const {
+	size_t bytes = _pilots.capacity() * sizeof(uint32_t) + _remap.capacity() * sizeof(size_t) + _slots.capacity() * sizeof(Slot);
+	for (const Slot& slot : _slots)
+		bytes += heap_bytes(slot.key) + heap_bytes(slot.val.name);
+	return bytes;
+}
+
+size_t FrozenHashTable::size() const {
+	return _size;
+}
+
+bool FrozenHashTable::empty() const {
+	return _size == 0;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "hash_table.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class FrozenHashTable {
+public:
+	// creates an empty frozen HT
+	FrozenHashTable();
+
+	// builds a minimal perfect hash over the keys of HT, so that every key gets its own slot and
+	// no slot stays empty. Cells are copied into one array in the order of their slots,
+	// so a lookup is one hash, one load of a pilot, one load of a slot and one comparison of keys
+	// (and one more load for the few keys whose slot is remapped).
+	// Expired cells of HT aren't copied. Later changes of HT don't affect the frozen HT
+	explicit FrozenHashTable(const HashTable& table);
+
+	// checks if frozen HT contains cell with the key or not
+	bool contains(const Key& k) const;
+
+	// returns the value corresponding to the key or throws a std::out_of_range exception
+	// if frozen HT doesn't contain that key
+	const Value& at(const Key& k) const;
+
+	// returns an estimated amount of bytes taken by the pilots, the remap and the slots,
+	// not counting the overhead of the allocator
+	size_t memory_usage() const;
+
+	// returns an actual amount of keys contained in frozen HT
+	size_t size() const;
+
+	// returns false if frozen HT size doesn't equal 0. If it does, returns true
+	bool empty() const;
+private:
+	// average amount of keys hashed into one bucket of pilots
+	static const size_t KEYS_PER_BUCKET = 4;
+	// keys are first placed into size / LOAD_FACTOR slots, which makes free slots easy to find
+	// for the last buckets. Keys placed beyond size are then remapped to the slots left free
+	static constexpr double LOAD_FACTOR = 0.98;
+	static const uint64_t MAX_PILOT = 1 << 20;
+	static const uint64_t MAX_SEEDS = 16;
+
+	struct Slot {
+		Key key;
+		Value val;
+		Slot(const Key&, const Value&);
+	};
+
+	size_t _size = 0;
+	size_t _table_size = 0;
+	uint64_t _seed = 0;
+	std::vector<uint32_t> _pilots;
+	std::vector<size_t> _remap;
+	std::vector<Slot, LargeArrayAllocator<Slot>> _slots;
+
+	size_t calc_bucket(uint64_t hash) const;
+
+	size_t calc_slot(uint64_t hash, uint32_t pilot) const;
+
+	const Slot* find(const Key& k) const;
+
+	bool place(const std::vector<uint64_t>& hashes, std::vector<size_t>& slot_of);
+};
@@ -1,14 +1,20 @@
 #include "hash_table.hpp"
+#include "key_hash.hpp"
+#include "trace.hpp"
+#include <algorithm>
 #include <exception>
+#include <functional>
+#include <limits>
 #include <stdexcept>
+#include <thread>
 
 using std::list;
 
-HashTable::Cell::Cell(const Key& k, const Value& v) : key(k), val(v) {};
+HashTable::Cell::Cell(const Key& k, const Value& v) : key(k), val(v), charge(calc_charge(k, v)) {};
 
 const Value HashTable::DEFAULT_VALUE = Value("", 0);
 
-uint32_t HashTable::calc_prime_hash(const Key& key) const {
+uint32_t HashTable::calc_prime_hash(const Key& key) {
 	static const uint32_t LARGE_PRIME = 4294967291;
 	static const uint32_t CHARS_AMOUNT = 256;
 	uint64_t powered_chars_amount = 1;
@@ -29,7 +35,7 @@ uint32_t HashTable::calc_hash(const Key& key) const {
 
 HashTable::HashTable() : _storage(INITIAL_CAPACITY, nullptr) {}
 
-void HashTable::free_storage(const std::vector<std::list<Cell>*>& storage) {
+void HashTable::free_storage(const Storage& storage) {
 	size_t size = _size;
 	for (int i = 0; (i < storage.size()) && (size > 0); ++i) {
 		if (storage[i]) {
@@ -40,7 +46,7 @@ void HashTable::free_storage(const std::vector<std::list<Cell>*>& storage) {
 }
 
 // storage must be freed
-void HashTable::copy_storage(const std::vector<std::list<Cell>*>& another_storage, size_t elem_amount) {
+void HashTable::copy_storage(const Storage& another_storage, size_t elem_amount) {
 	if (_storage.size() != another_storage.size())
 		_storage.resize(another_storage.size());
 	for (int i = 0; (i < _storage.size()) && (elem_amount > 0); ++i) {
@@ -51,21 +57,34 @@ void HashTable::copy_storage(const std::vector<std::list<Cell>*>& another_storag
 }
 
 HashTable::~HashTable() {
+	preserve_all();
 	this->free_storage(_storage);
 }
 
 bool HashTable::prime_insert(const Key& k, const Value& v) {
-	std::list<Cell>*& list = _storage[calc_hash(k)];
+	return prime_insert_at(calc_hash(k), k, v);
+}
+
+bool HashTable::prime_insert_at(size_t cell_id, const Key& k, const Value& v) {
+	preserve(cell_id);
+	std::list<Cell>*& list = _storage[cell_id];
 	if (!list)
 		list = new std::list<Cell>;
 
 	auto it = std::find_if(list->begin(), list->end(), [&k](Cell& c) { return c.key == k; });
 	if (it != list->end()) {
+		unindex_age(k, it->val);
 		it->val = v;
+		it->charge = calc_charge(k, v);
+		it->expires = Clock::time_point::max();
+		index_age(k, v);
 		return false;
 	}
 
 	list->emplace_back(k, v);
+	index_age(k, v);
+	if (_filter.counters.enabled())
+		_filter.counters.add(calc_key_hash(k));
 	return true;
 }
 
@@ -73,73 +92,283 @@ HashTable& HashTable::operator=(const HashTable& b) {
 	if (this == &b)
 		return *this;
 
+	preserve_all();
 	free_storage(_storage);
 	copy_storage(b._storage, b._size);
 	_size = b._size;
+	_parallel_rehash_size = b._parallel_rehash_size;
+	_rehash_threads = b._rehash_threads;
+	_eviction = b._eviction;
+	_expiry = b._expiry;
+	_age_index = b._age_index;
+	_filter = b._filter;
 	return *this;
 }
 
-HashTable::HashTable(const HashTable& b) : _size(b._size), _storage(b._storage.size(), nullptr) {
+HashTable::HashTable(const HashTable& b) : _size(b._size), _parallel_rehash_size(b._parallel_rehash_size),
+	_rehash_threads(b._rehash_threads), _eviction(b._eviction), _expiry(b._expiry), _age_index(b._age_index), _filter(b._filter), _storage(b._storage.size(), nullptr) {
 	copy_storage(b._storage, b._size);
 }
 
 void HashTable::swap(HashTable& b) {
+	preserve_all();
+	b.preserve_all();
 	std::swap(_storage, b._storage);
 	std::swap(_size, b._size);
+	std::swap(_parallel_rehash_size, b._parallel_rehash_size);
+	std::swap(_rehash_threads, b._rehash_threads);
+	std::swap(_eviction, b._eviction);
+	std::swap(_expiry, b._expiry);
+	std::swap(_age_index, b._age_index);
+	std::swap(_filter, b._filter);
 }
 
 void HashTable::clear() {
+	if (_trace)
+		_trace->write(TraceOp::CLEAR, Key());
+	preserve_all();
 	free_storage(_storage);
 	_storage.clear();
 	_storage.resize(INITIAL_CAPACITY, nullptr);
 	_size = 0;
+	_eviction.bytes = 0;
+	_eviction.clock_hand = 0;
+	_expiry = Expiry();
+	set_age_index(_age_index.enabled);
+	rebuild_filter();
+}
+
+size_t HashTable::rehash_threads() const {
+	if (_rehash_threads)
+		return _rehash_threads;
+	return std::max<size_t>(std::thread::hardware_concurrency(), 1);
 }
 
 void HashTable::resize_storage(size_t new_size) {
-	const std::vector<std::list<Cell>*> old_storage = std::move(_storage);
+	preserve_all();
+	if (_parallel_rehash_size && (_size >= _parallel_rehash_size)) {
+		size_t threads = rehash_threads();
+		if (threads > 1) {
+			parallel_resize_storage(new_size, threads);
+			return;
+		}
+	}
+
+	// nodes are spliced into their new lists, so no cell is copied
+	Storage old_storage = std::move(_storage);
 	_storage.resize(new_size, nullptr);
 
 	size_t size = _size;
-	for (auto list_ptr : old_storage) {
+	for (auto& list_ptr : old_storage) {
 		if (!list_ptr)
 			continue;
 		size -= list_ptr->size();
-		for (const auto& cell : *list_ptr) {
-			size_t cell_id = calc_hash(cell.key);
+		while (!list_ptr->empty()) {
+			size_t cell_id = calc_hash(list_ptr->front().key);
 			if (!_storage[cell_id])
 				_storage[cell_id] = new std::list<Cell>;
-			_storage[cell_id]->push_back(cell);
+			_storage[cell_id]->splice(_storage[cell_id]->end(), *list_ptr, list_ptr->begin());
 		}
+		delete list_ptr;
+		list_ptr = nullptr;
 		if (!size)
 			break;
 	}
 
+	rebuild_filter();
+}
+
+void HashTable::run_parallel(size_t threads, const std::function<void(size_t)>& job) {
+	std::vector<std::thread> workers;
+	workers.reserve(threads);
+	for (size_t t = 0; t < threads; ++t)
+		workers.emplace_back(job, t);
+	for (auto& worker : workers)
+		worker.join();
+}
+
+// old buckets are split between workers, every worker scatters its cells by the range of
+// their destination bucket. Then every worker fills buckets of its own range only,
+// so the new storage is built without any locking
+void HashTable::parallel_resize_storage(size_t new_size, size_t threads) {
+	Storage old_storage = std::move(_storage);
+	_storage.resize(new_size, nullptr);
+	threads = std::min(threads, new_size);
+
+	typedef std::vector<std::pair<size_t, Cell*>> Staging;
+	std::vector<std::vector<Staging>> staging(threads, std::vector<Staging>(threads));
+
+	run_parallel(threads, [this, &old_storage, &staging, threads, new_size](size_t t) {
+		size_t first = old_storage.size() * t / threads;
+		size_t last = old_storage.size() * (t + 1) / threads;
+		for (size_t i = first; i < last; ++i) {
+			if (!old_storage[i])
+				continue;
+			for (auto& cell : *old_storage[i]) {
+				size_t cell_id = calc_hash(cell.key);
+				staging[t][cell_id * threads / new_size].emplace_back(cell_id, &cell);
+			}
+		}
+	});
+
+	run_parallel(threads, [this, &staging, threads](size_t r) {
+		for (size_t t = 0; t < threads; ++t) {
+			for (const auto& [cell_id, cell] : staging[t][r]) {
+				if (!_storage[cell_id])
+					_storage[cell_id] = new std::list<Cell>;
+				_storage[cell_id]->push_back(std::move(*cell));
+			}
+		}
+	});
+
 	free_storage(old_storage);
+	rebuild_filter();
+}
+
+// the same scatter as in parallel_resize_storage, but every worker also counts the keys
+// of its range, so that duplicates are overwritten exactly as insert does
+HashTable HashTable::build_from(const std::vector<std::pair<Key, Value>>& entries, size_t threads) {
+	HashTable result;
+	size_t new_size = result._storage.size();
+	while (entries.size() * OVERFLOW_COEF >= new_size)
+		new_size *= EXPAND_COEF;
+	result._storage.resize(new_size, nullptr);
+
+	if (!threads)
+		threads = result.rehash_threads();
+	threads = std::min(threads, new_size);
+
+	typedef std::vector<std::pair<size_t, const std::pair<Key, Value>*>> Staging;
+	std::vector<std::vector<Staging>> staging(threads, std::vector<Staging>(threads));
+	std::vector<size_t> inserted(threads, 0);
+
+	run_parallel(threads, [&result, &entries, &staging, threads, new_size](size_t t) {
+		size_t first = entries.size() * t / threads;
+		size_t last = entries.size() * (t + 1) / threads;
+		for (size_t i = first; i < last; ++i) {
+			size_t cell_id = result.calc_hash(entries[i].first);
+			staging[t][cell_id * threads / new_size].emplace_back(cell_id, &entries[i]);
+		}
+	});
+
+	run_parallel(threads, [&result, &staging, &inserted, threads](size_t r) {
+		for (size_t t = 0; t < threads; ++t) {
+			for (const auto& [cell_id, entry] : staging[t][r]) {
+				if (result.prime_insert_at(cell_id, entry->first, entry->second))
+					++inserted[r];
+			}
+		}
+	});
+
+	for (size_t n : inserted)
+		result._size += n;
+	return result;
+}
+
+void HashTable::merge(HashTable&& b) {
+	if (this == &b)
+		return;
+	preserve_all();
+	b.preserve_all();
+	reserve(_size + b._size);
+	_expiry.enabled = _expiry.enabled || b._expiry.enabled;
+
+	size_t size = b._size;
+	for (size_t i = 0; (i < b._storage.size()) && (size > 0); ++i) {
+		std::list<Cell>*& from = b._storage[i];
+		if (!from)
+			continue;
+		size -= from->size();
+		while (!from->empty()) {
+			std::list<Cell>*& to = _storage[calc_hash(from->front().key)];
+			if (!to)
+				to = new std::list<Cell>;
+			const Key& k = from->front().key;
+			auto it = std::find_if(to->begin(), to->end(), [&k](const Cell& c) { return c.key == k; });
+			if (it != to->end()) {
+				unindex_age(k, it->val);
+				it->val = std::move(from->front().val);
+				it->charge = from->front().charge;
+				it->expires = from->front().expires;
+				index_age(k, it->val);
+				from->pop_front();
+				continue;
+			}
+			index_age(k, from->front().val);
+			to->splice(to->end(), *from, from->begin());
+			++_size;
+		}
+		delete from;
+		from = nullptr;
+	}
+
+	b._size = 0;
+	b.clear();
+	rebuild_filter();
+
+	if (evicting())
+		set_capacity(_eviction.max_entries, _eviction.max_bytes);
+}
+
+void HashTable::reserve(size_t n) {
+	size_t new_size = _storage.size();
+	while (n * OVERFLOW_COEF >= new_size)
+		new_size *= EXPAND_COEF;
+	if (new_size != _storage.size())
+		resize_storage(new_size);
+}
+
+void HashTable::set_parallel_rehash(size_t min_size, size_t threads) {
+	_parallel_rehash_size = min_size;
+	_rehash_threads = threads;
 }
 
 bool HashTable::erase(const Key& k) {
-	std::list<Cell>*& list = _storage[calc_hash(k)];
+	if (_trace)
+		_trace->write(TraceOp::ERASE, k);
+	return erase_cell(k);
+}
+
+bool HashTable::erase_cell(const Key& k) {
+	size_t cell_id = calc_hash(k);
+	std::list<Cell>*& list = _storage[cell_id];
 	if (!list)
 		return false;
 
-	size_t n_removed = list->remove_if([&k](const Cell& c) { return c.key == k; });
-	if (n_removed == 0)
+	auto it = std::find_if(list->begin(), list->end(), [&k](const Cell& c) { return c.key == k; });
+	if (it == list->end())
 		return false;
 
+	preserve(cell_id);
+	bool live = !_expiry.enabled || (it->expires > Clock::now());
+	unindex_age(k, it->val);
+	if (evicting())
+		_eviction.bytes -= it->charge;
+	if (_filter.counters.enabled())
+		_filter.counters.remove(calc_key_hash(k));
+	list->erase(it);
+
 	if (list->empty()) {
 		delete list;
 		list = nullptr;
 	}
 
 	--_size;
-
-	if ((_storage.size() > INITIAL_CAPACITY) && (_size * OVERFLOW_COEF < _storage.size()))
-		resize_storage(_storage.size() / EXPAND_COEF);
-
-	return true;
+	shrink_storage();
+	return live;
 }
 
 bool HashTable::insert(const Key& k, const Value& v) {
+	if (_trace)
+		_trace->write(TraceOp::INSERT, k, v);
+	return insert_cell(k, v);
+}
+
+bool HashTable::insert_cell(const Key& k, const Value& v) {
+	reclaim(k);
+	if (evicting())
+		return insert_evicting(k, v);
+
 	if ((_size + 1) * OVERFLOW_COEF >= _storage.size())
 		resize_storage(_storage.size() * EXPAND_COEF);
 
@@ -151,6 +380,9 @@ bool HashTable::insert(const Key& k, const Value& v) {
 }
 
 HashTable::Cell* HashTable::find(const Key& k) const {
+	if (_filter.counters.enabled() && !_filter.counters.may_contain(calc_key_hash(k)))
+		return nullptr;
+
 	std::list<Cell>* list = _storage[calc_hash(k)];
 	if (!list)
 		return nullptr;
@@ -162,39 +394,401 @@ HashTable::Cell* HashTable::find(const Key& k) const {
 	return &(*it);
 }
 
+HashTable::Cell* HashTable::find_live(const Key& k) const {
+	Cell* c = find(k);
+	if (c && _expiry.enabled && (c->expires <= Clock::now()))
+		return nullptr;
+	return c;
+}
+
+void HashTable::reclaim(const Key& k) {
+	if (!_expiry.enabled)
+		return;
+	Cell* c = find(k);
+	if (c && (c->expires <= Clock::now()))
+		erase_cell(k);
+}
+
+bool HashTable::insert(const Key& k, const Value& v, Clock::duration ttl) {
+	if (_trace)
+		_trace->write(TraceOp::INSERT_TTL, k, v, ttl);
+	bool result = insert_cell(k, v);
+	Clock::time_point now = Clock::now();
+	ttl = std::max(ttl, Clock::duration::zero());
+	find(k)->expires = ttl >= Clock::time_point::max() - now ? Clock::time_point::max() : now + ttl;
+	_expiry.enabled = true;
+	return result;
+}
+
+// expired cells are removed right from their lists. The storage isn't shrunk here, since that
+// rehashes every cell: the next erase shrinks it
+size_t HashTable::expire_some(size_t max_buckets) {
+	if (!_expiry.enabled)
+		return 0;
+
+	Clock::time_point now = Clock::now();
+	size_t removed = 0;
+	max_buckets = std::min(max_buckets, _storage.size());
+	for (size_t i = 0; i < max_buckets; ++i) {
+		if (_expiry.hand >= _storage.size())
+			_expiry.hand = 0;
+		size_t cell_id = _expiry.hand++;
+		std::list<Cell>*& list = _storage[cell_id];
+		if (!list || std::none_of(list->begin(), list->end(), [now](const Cell& c) { return c.expires <= now; }))
+			continue;
+		preserve(cell_id);
+		for (auto it = list->begin(); it != list->end();) {
+			if (it->expires > now) {
+				++it;
+				continue;
+			}
+			if (evicting())
+				_eviction.bytes -= it->charge;
+			if (_filter.counters.enabled())
+				_filter.counters.remove(calc_key_hash(it->key));
+			unindex_age(it->key, it->val);
+			it = list->erase(it);
+			++removed;
+		}
+		if (list->empty()) {
+			delete list;
+			list = nullptr;
+		}
+	}
+	_size -= removed;
+	return removed;
+}
+
+// shrinks the storage in one rehash, however many cells were removed since the last one
+void HashTable::shrink_storage() {
+	size_t new_size = _storage.size();
+	while ((new_size > INITIAL_CAPACITY) && (_size * OVERFLOW_COEF < new_size))
+		new_size /= EXPAND_COEF;
+	if (new_size != _storage.size())
+		resize_storage(new_size);
+}
+
 bool HashTable::contains(const Key& k) const {
-	const Cell* c = find(k);
+	if (_trace)
+		_trace->write(TraceOp::CONTAINS, k);
+	Cell* c = find_live(k);
+	touch(c);
 	return c != nullptr;
 }
 
 Value& HashTable::operator[](const Key& k) {
+	if (_trace)
+		_trace->write(TraceOp::SUBSCRIPT, k);
+	reclaim(k);
 	std::list<Cell>* list = _storage[calc_hash(k)];
 
 	std::list<Cell>::iterator it;
 	if ((!list) || ((it = std::find_if(list->begin(), list->end(), [&k](Cell& c) { return c.key == k; })) == list->end())) {
-		insert(k, DEFAULT_VALUE);
+		insert_cell(k, DEFAULT_VALUE);
 		list = _storage[calc_hash(k)];
+		touch_age(k, list->back().val);
 		return list->back().val;
 	}
 
+	preserve(calc_hash(k));
+	touch(&*it);
+	touch_age(k, it->val);
 	return it->val;
 }
 
 const Value& HashTable::const_at(const Key& k) const {
-	const Cell* c = find(k);
+	Cell* c = find_live(k);
 	if (c == nullptr)
 		throw std::out_of_range("at threw to you \"out of range\"-exception");
+	touch(c);
 	return c->val;
 }
 
 Value& HashTable::at(const Key& k) {
-	return const_cast<Value&>(const_at(k));
+	if (_trace)
+		_trace->write(TraceOp::AT, k);
+	reclaim(k);
+	preserve(calc_hash(k));
+	Value& v = const_cast<Value&>(const_at(k));
+	touch_age(k, v);
+	return v;
 }
 
 const Value& HashTable::at(const Key& k) const {
+	if (_trace)
+		_trace->write(TraceOp::AT, k);
 	return const_at(k);
 }
 
+uint32_t HashTable::calc_charge(const Key& k, const Value& v) {
+	return static_cast<uint32_t>(sizeof(Cell) + k.size() + v.name.size());
+}
+
+bool HashTable::evicting() const {
+	return _eviction.max_entries || _eviction.max_bytes;
+}
+
+// marking is skipped without a capacity, so that const lookups of a plain HT never write to it
+void HashTable::touch(Cell* c) const {
+	if (c && evicting())
+		c->referenced = true;
+}
+
+bool HashTable::overflows(size_t extra_entries, size_t extra_bytes) const {
+	if (_eviction.max_entries && (_size + extra_entries > _eviction.max_entries))
+		return true;
+	return _eviction.max_bytes && (_eviction.bytes + extra_bytes > _eviction.max_bytes);
+}
+
+// cells are removed right from their lists: erase could shrink the storage on every eviction
+void HashTable::evict_one(const Cell* keep) {
+	Eviction& e = _eviction;
+	while (true) {
+		if (e.clock_hand >= _storage.size())
+			e.clock_hand = 0;
+		std::list<Cell>*& list = _storage[e.clock_hand];
+		if (list) {
+			for (auto it = list->begin(); it != list->end(); ++it) {
+				if (&*it == keep)
+					continue;
+				if (it->referenced) {
+					it->referenced = false;
+					continue;
+				}
+				preserve(e.clock_hand);
+				if (e.callback)
+					e.callback(it->key, it->val);
+				e.bytes -= it->charge;
+				if (_filter.counters.enabled())
+					_filter.counters.remove(calc_key_hash(it->key));
+				unindex_age(it->key, it->val);
+				list->erase(it);
+				if (list->empty()) {
+					delete list;
+					list = nullptr;
+				}
+				--_size;
+				return;
+			}
+		}
+		++e.clock_hand;
+	}
+}
+
+bool HashTable::insert_evicting(const Key& k, const Value& v) {
+	Cell* c = find(k);
+	if (c) {
+		preserve(calc_hash(k));
+		unindex_age(k, c->val);
+		_eviction.bytes -= c->charge;
+		c->val = v;
+		c->charge = calc_charge(k, v);
+		c->expires = Clock::time_point::max();
+		c->referenced = true;
+		_eviction.bytes += c->charge;
+		index_age(k, v);
+		while ((_size > 1) && overflows(0, 0))
+			evict_one(c);
+		return false;
+	}
+
+	uint32_t charge = calc_charge(k, v);
+	while (_size && overflows(1, charge))
+		evict_one(nullptr);
+
+	if ((_size + 1) * OVERFLOW_COEF >= _storage.size())
+		resize_storage(_storage.size() * EXPAND_COEF);
+	prime_insert(k, v);
+	++_size;
+	_eviction.bytes += charge;
+	return true;
+}
+
+void HashTable::set_capacity(size_t max_entries, size_t max_bytes) {
+	_eviction.max_entries = max_entries;
+	_eviction.max_bytes = max_bytes;
+	if (!evicting())
+		return;
+
+	_eviction.bytes = 0;
+	size_t size = _size;
+	for (size_t i = 0; (i < _storage.size()) && (size > 0); ++i) {
+		if (!_storage[i])
+			continue;
+		size -= _storage[i]->size();
+		for (const auto& cell : *_storage[i])
+			_eviction.bytes += cell.charge;
+	}
+	while (_size && overflows(0, 0))
+		evict_one(nullptr);
+	shrink_storage();
+}
+
+void HashTable::set_eviction_callback(EvictionCallback callback) {
+	_eviction.callback = std::move(callback);
+}
+
+size_t HashTable::bytes() const {
+	return _eviction.bytes;
+}
+
+// build_from fills a fresh HT from several threads, so the index is only written when it is on
+void HashTable::index_age(const Key& k, const Value& v) {
+	if (_age_index.enabled)
+		_age_index.entries.emplace(v.age, k);
+}
+
+// a key given by reference is indexed by the age it had then, not by its current one
+void HashTable::unindex_age(const Key& k, const Value& v) {
+	if (!_age_index.enabled)
+		return;
+	unsigned int age = v.age;
+	auto touched = _age_index.touched.find(k);
+	if (touched != _age_index.touched.end()) {
+		age = touched->second;
+		_age_index.touched.erase(touched);
+	}
+	_age_index.entries.erase({ age, k });
+}
+
+// the first reference wins, as the index still holds the age the key had before it
+void HashTable::touch_age(const Key& k, const Value& v) {
+	if (_age_index.enabled)
+		_age_index.touched.emplace(k, v.age);
+}
+
+void HashTable::reindex_touched_ages() {
+	for (const auto& [k, age] : _age_index.touched) {
+		_age_index.entries.erase({ age, k });
+		const Cell* c = find(k);
+		if (c)
+			_age_index.entries.emplace(c->val.age, k);
+	}
+	_age_index.touched.clear();
+}
+
+void HashTable::set_age_index(bool enabled) {
+	_age_index = AgeIndex();
+	_age_index.enabled = enabled;
+	if (!enabled)
+		return;
+
+	std::vector<std::pair<unsigned int, Key>> entries;
+	entries.reserve(_size);
+	collect_ages(entries, 0, std::numeric_limits<unsigned int>::max());
+	_age_index.entries.insert(entries.begin(), entries.end());
+}
+
+void HashTable::collect_ages(std::vector<std::pair<unsigned int, Key>>& entries, unsigned int a, unsigned int b) const {
+	size_t size = _size;
+	for (size_t i = 0; (i < _storage.size()) && (size > 0); ++i) {
+		if (!_storage[i])
+			continue;
+		size -= _storage[i]->size();
+		for (const auto& cell : *_storage[i]) {
+			if ((cell.val.age >= a) && (cell.val.age <= b))
+				entries.emplace_back(cell.val.age, cell.key);
+		}
+	}
+	std::sort(entries.begin(), entries.end());
+}
+
+std::vector<Key> HashTable::range_by_age(unsigned int a, unsigned int b) {
+	std::vector<Key> result;
+	if (a > b)
+		return result;
+
+	if (_age_index.enabled) {
+		reindex_touched_ages();
+		auto& entries = _age_index.entries;
+		for (auto it = entries.lower_bound({ a, Key() }); (it != entries.end()) && (it->first <= b); ++it) {
+			if (!_expiry.enabled || find_live(it->second))
+				result.push_back(it->second);
+		}
+		return result;
+	}
+
+	std::vector<std::pair<unsigned int, Key>> scanned;
+	collect_ages(scanned, a, b);
+	for (const auto& [age, k] : scanned) {
+		if (!_expiry.enabled || find_live(k))
+			result.push_back(k);
+	}
+	return result;
+}
+
+// the filter is sized for the amount of keys the storage holds before its next expand
+void HashTable::rebuild_filter() {
+	if (_filter.fp_rate <= 0) {
+		_filter.counters = CountingBloomFilter();
+		return;
+	}
+
+	_filter.counters = CountingBloomFilter(_storage.size() / OVERFLOW_COEF, _filter.fp_rate);
+	size_t size = _size;
+	for (size_t i = 0; (i < _storage.size()) && (size > 0); ++i) {
+		if (!_storage[i])
+			continue;
+		size -= _storage[i]->size();
+		for (const auto& cell : *_storage[i])
+			_filter.counters.add(calc_key_hash(cell.key));
+	}
+}
+
+void HashTable::set_filter(double fp_rate) {
+	_filter.fp_rate = fp_rate;
+	rebuild_filter();
+}
+
+void HashTable::set_trace(TraceWriter* trace) {
+	_trace = trace;
+}
+
+void HashTable::for_each(const std::function<void(const Key&, const Value&)>& f) const {
+	Clock::time_point now = _expiry.enabled ? Clock::now() : Clock::time_point();
+	size_t size = _size;
+	for (size_t i = 0; (i < _storage.size()) && (size > 0); ++i) {
+		if (!_storage[i])
+			continue;
+		size -= _storage[i]->size();
+		for (const auto& cell : *_storage[i]) {
+			if (!_expiry.enabled || (cell.expires > now))
+				f(cell.key, cell.val);
+		}
+	}
+}
+
+// the i-th cell of a list is found after i comparisons
+HashTable::ChainStats HashTable::chain_stats() const {
+	ChainStats stats;
+	stats.buckets = _storage.size();
+	size_t compares = 0;
+	for (const std::list<Cell>* list : _storage) {
+		if (!list)
+			continue;
+		++stats.used_buckets;
+		stats.longest = std::max(stats.longest, list->size());
+		compares += list->size() * (list->size() + 1) / 2;
+	}
+	if (_size)
+		stats.compares_per_hit = static_cast<double>(compares) / _size;
+	return stats;
+}
+
+size_t HashTable::memory_usage() const {
+	// every node of a list holds a cell and two links
+	const size_t NODE_BYTES = sizeof(Cell) + 2 * sizeof(void*);
+	size_t bytes = _storage.capacity() * sizeof(std::list<Cell>*);
+	for (const std::list<Cell>* list : _storage) {
+		if (!list)
+			continue;
+		bytes += sizeof(std::list<Cell>) + list->size() * NODE_BYTES;
+		for (const auto& cell : *list)
+			bytes += heap_bytes(cell.key) + heap_bytes(cell.val.name);
+	}
+	return bytes;
+}
+
 size_t HashTable::size() const {
 	return _size;
 }
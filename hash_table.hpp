@@ -1,18 +1,38 @@
 #pragma once
+#include "counting_bloom_filter.hpp"
+#include "large_array_allocator.hpp"
 #include <string>
 #include <vector>
 #include <list>
+#include <chrono>
 #include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
 typedef std::string Key;
 
+class TraceWriter;
+
 struct Value {
 	Value(std::string n, unsigned int a = 0) : name(n), age(a) {}
 	std::string name;
 	unsigned int age;
 };
 
+// bytes a string takes on the heap, 0 if it fits into the string itself
+inline size_t heap_bytes(const std::string& s) {
+	return s.capacity() > std::string().capacity() ? s.capacity() + 1 : 0;
+}
+
 class HashTable {
 public:
+	typedef std::chrono::steady_clock Clock;
+
+	// receives every cell evicted because of the capacity, right before the cell is removed
+	typedef std::function<void(const Key&, const Value&)> EvictionCallback;
+
 	// creates an empty HT. Empty HT consist of vector of 16 empty lists
 	// so that constructor initializes corresponding values and resizes the lists vector
 	HashTable();
@@ -43,20 +63,144 @@ public:
 	// with even distribution
 	bool insert(const Key& k, const Value& v);
 
+	// the same as insert, but the cell expires after ttl. An expired cell behaves as if it were erased,
+	// though it takes memory and is counted by size until it is reclaimed: by insert, erase, operator[]
+	// or non-const at of its key, or by expire_some. A plain insert makes the cell never expire.
+	// A cell whose ttl reaches beyond Clock::time_point::max() never expires, a negative ttl counts as 0
+	bool insert(const Key& k, const Value& v, Clock::duration ttl);
+
+	// the same for a ttl of any other duration type, which is converted without overflow
+	template <class Rep, class Period>
+	bool insert(const Key& k, const Value& v, std::chrono::duration<Rep, Period> ttl) {
+		if (ttl <= ttl.zero())
+			return insert(k, v, Clock::duration::zero());
+		if (std::chrono::duration<double>(ttl) >= std::chrono::duration<double>(Clock::duration::max()))
+			return insert(k, v, Clock::duration::max());
+		return insert(k, v, std::chrono::duration_cast<Clock::duration>(ttl));
+	}
+
+	// visits at most max_buckets buckets, continuing from where the previous call stopped,
+	// and reclaims expired cells found there. Never resizes the storage, the next erase shrinks it.
+	// Returns the amount of reclaimed cells
+	size_t expire_some(size_t max_buckets);
+
 	// checks if HT contains cell with the key or not.
 	// true if k is present in hash table, false otherwise
 	bool contains(const Key& k) const;
 
+	// looks up all the keys, keeping up to group_size lookups in flight on the calling thread.
+	// Every lookup is a coroutine which prefetches the bucket, the list and each node before reading
+	// them and suspends meanwhile, so that other lookups run while the memory is loaded.
+	// Returns pointers to the values, nullptr for absent keys. Pointers are valid until HT is changed
+	std::vector<const Value*> find_interleaved(const std::vector<Key>& keys, size_t group_size) const;
+
 	// if HT contains requesting key then [] returns a reference to the value, corresponding to the
 	// HT cell which contains that key.
-	// If it doesn't then default value inserted to HT table with that key and returns newly inserted value
+	// If it doesn't then default value inserted to HT table with that key and returns newly inserted value.
+	// A reference taken before a snapshot must not be written while the snapshot is alive: take it again
 	Value& operator[](const Key& k);
 
 	// behave the same as the operator[] except if HT doesn't contain the key.
-	// If that happens then "at" will throw a std::out_of_range exception
+	// If that happens then "at" will throw a std::out_of_range exception.
+	// A reference taken before a snapshot must not be written while the snapshot is alive: take it again
 	Value& at(const Key& k);
 	const Value& at(const Key& k) const;
 
+	// grows the storage so that n keys fit into HT without any further expand.
+	// Never shrinks the storage
+	void reserve(size_t n);
+
+	// moves all cells of b into HT without copying them. If both HTs contain the same key,
+	// the value from b replaces the value of HT, as insert does. b becomes empty
+	void merge(HashTable&& b);
+
+	// builds HT from entries using "threads" worker threads (0 means as many as the hardware supports).
+	// Every worker fills its own range of buckets, so no cell is rehashed after being placed.
+	// If entries contain the same key several times, the last value is kept
+	static HashTable build_from(const std::vector<std::pair<Key, Value>>& entries, size_t threads = 0);
+
+	// storage of HT containing at least min_size keys is rehashed by "threads" worker threads
+	// (0 means as many as the hardware supports). min_size equal to 0 turns parallel rehash off
+	void set_parallel_rehash(size_t min_size, size_t threads = 0);
+
+	// turns HT into a bounded cache holding at most max_entries keys and at most max_bytes bytes
+	// of cells (0 means no limit, both 0 turn the eviction off). When a new key doesn't fit, cells
+	// are evicted with the CLOCK policy: contains, at and operator[] only mark a cell as used,
+	// and the clock hand sweeping the buckets evicts the first cell not used since its previous pass.
+	// Bytes of a cell are estimated from its key and name when the value is inserted. A newly
+	// inserted cell is always kept, even if it alone is larger than max_bytes. The cells evicted
+	// by set_capacity itself are followed by shrinking the storage, as erase does
+	void set_capacity(size_t max_entries, size_t max_bytes = 0);
+
+	void set_eviction_callback(EvictionCallback callback);
+
+	// returns an estimated amount of bytes taken by the cells. Counted only while a capacity is set
+	size_t bytes() const;
+
+	// turns the secondary index on Value::age on or off. The index is an ordered set, which
+	// insert, erase, eviction and expiry update in place. Keys given by reference from operator[]
+	// or at are only remembered, and are indexed again by the next range_by_age
+	void set_age_index(bool enabled);
+
+	// returns keys of all cells with age from a to b inclusive, ordered by age. Uses the index
+	// if it is on, reindexing the keys given by reference first. Otherwise scans all the buckets
+	std::vector<Key> range_by_age(unsigned int a, unsigned int b);
+
+	// keeps a counting Bloom filter of the keys next to the storage, so that most lookups of absent
+	// keys are answered by one cache line without walking a bucket. fp_rate is the desired share
+	// of absent keys which still walk their bucket. fp_rate equal to 0 turns the filter off
+	void set_filter(double fp_rate);
+
+	// starts writing every call of insert, erase, contains, at, operator[] and clear into the trace,
+	// nullptr stops it. HT doesn't own the writer. The trace isn't inherited by copies of HT
+	void set_trace(TraceWriter* trace);
+
+	// read-only view of HT as it was when it was taken. A snapshot may be read from any thread while
+	// the writer keeps changing HT. It returns values by copy, since it never blocks the writer
+	// for longer than one lookup. A snapshot outlives HT it was taken from
+	class Snapshot {
+	public:
+		bool contains(const Key& k) const;
+
+		// throws a std::out_of_range exception if the snapshot doesn't contain the key
+		Value at(const Key& k) const;
+
+		size_t size() const;
+
+		bool empty() const;
+	private:
+		friend class HashTable;
+		struct State;
+		std::shared_ptr<State> _state;
+	};
+
+	// takes a snapshot in O(1). Until the last copy of the snapshot is released, the first change of
+	// every bucket copies the bucket once for all the snapshots which don't have it yet. Resize, clear,
+	// swap, merge, assignment and destruction of HT copy all the remaining buckets at once.
+	// Must be called from the writer's thread, like any other method of HT. A bucket is copied only
+	// by a method of HT, so a reference given by operator[] or at before the snapshot bypasses it:
+	// writing through it would change the snapshot too and race with its readers. Such references
+	// must be taken again by operator[] or at before they are written
+	Snapshot snapshot();
+
+	// calls f for every cell of HT, except expired ones, in no particular order. f must not change HT
+	void for_each(const std::function<void(const Key&, const Value&)>& f) const;
+
+	// lengths of the bucket lists, showing how evenly the keys are spread
+	struct ChainStats {
+		size_t buckets = 0;
+		size_t used_buckets = 0;
+		size_t longest = 0;
+		// average amount of cells compared by a lookup of a contained key
+		double compares_per_hit = 0;
+	};
+
+	ChainStats chain_stats() const;
+
+	// returns an estimated amount of bytes taken by the storage, the lists and the cells,
+	// not counting the overhead of the allocator
+	size_t memory_usage() const;
+
 	// returns an actual amount of keys contained in HT
 	size_t size() const;
 
@@ -67,37 +211,139 @@ public:
 	// equal keys and equal values in any order. in this case operator returns true. In any other cases it returns false.
 	friend bool operator==(const HashTable& a, const HashTable& b);
 	friend bool operator!=(const HashTable& a, const HashTable& b);
+
+	friend class FrozenHashTable;
 private:
 	static const size_t EXPAND_COEF = 2;
 	static const size_t OVERFLOW_COEF = 2;
 	static const size_t INITIAL_CAPACITY = 8;
 
+	static const size_t DEFAULT_PARALLEL_REHASH_SIZE = 1 << 20;
+
 	static const Value DEFAULT_VALUE;
 
 	size_t _size = 0;
 
+	size_t _parallel_rehash_size = DEFAULT_PARALLEL_REHASH_SIZE;
+	size_t _rehash_threads = 0;
+
 	struct Cell {
 		Key key;
 		Value val;
+		uint32_t charge;
+		bool referenced = false;
+		Clock::time_point expires = Clock::time_point::max();
 		Cell(const Key&, const Value&);
 	};
 
-	std::vector<std::list<Cell>*> _storage;
+	struct Eviction {
+		size_t max_entries = 0;
+		size_t max_bytes = 0;
+		size_t bytes = 0;
+		size_t clock_hand = 0;
+		EvictionCallback callback;
+	};
+
+	Eviction _eviction;
+
+	struct Expiry {
+		bool enabled = false;
+		size_t hand = 0;
+	};
+
+	Expiry _expiry;
+
+	// touched maps keys given by reference to the age they are indexed by
+	struct AgeIndex {
+		bool enabled = false;
+		std::set<std::pair<unsigned int, Key>> entries;
+		std::unordered_map<Key, unsigned int> touched;
+	};
+
+	AgeIndex _age_index;
+
+	struct Filter {
+		double fp_rate = 0;
+		CountingBloomFilter counters;
+	};
+
+	Filter _filter;
+
+	TraceWriter* _trace = nullptr;
+
+	struct Versions;
+
+	// shared with the snapshots taken from HT, neither copied nor swapped
+	std::shared_ptr<Versions> _versions;
+
+	typedef std::vector<std::list<Cell>*, LargeArrayAllocator<std::list<Cell>*>> Storage;
+
+	Storage _storage;
 
 	void resize_storage(size_t new_size);
 
-	void free_storage(const std::vector<std::list<Cell>*>& storage);
+	void shrink_storage();
+
+	void parallel_resize_storage(size_t new_size, size_t threads);
+
+	size_t rehash_threads() const;
+
+	static void run_parallel(size_t threads, const std::function<void(size_t)>& job);
 
-	void copy_storage(const std::vector<std::list<Cell>*>& another_storage, size_t elem_amount);
+	void free_storage(const Storage& storage);
+
+	void copy_storage(const Storage& another_storage, size_t elem_amount);
 
 	Cell* find(const Key&) const;
 
-	uint32_t calc_prime_hash(const Key&) const;
+	Cell* find_live(const Key&) const;
+
+	struct LookupTask;
+
+	LookupTask probe(const Key& k, const Value*& result) const;
+
+	void reclaim(const Key&);
+
+	static uint32_t calc_prime_hash(const Key&);
 
 	uint32_t calc_hash(const Key&) const;
 
+	bool insert_cell(const Key& k, const Value& v);
+
+	bool erase_cell(const Key& k);
+
 	bool prime_insert(const Key& k, const Value& v);
 
+	bool prime_insert_at(size_t cell_id, const Key& k, const Value& v);
+
 	const Value& const_at(const Key&) const;
 
+	static uint32_t calc_charge(const Key& k, const Value& v);
+
+	bool evicting() const;
+
+	void touch(Cell* c) const;
+
+	bool insert_evicting(const Key& k, const Value& v);
+
+	bool overflows(size_t extra_entries, size_t extra_bytes) const;
+
+	void evict_one(const Cell* keep);
+
+	void index_age(const Key& k, const Value& v);
+
+	void unindex_age(const Key& k, const Value& v);
+
+	void touch_age(const Key& k, const Value& v);
+
+	void reindex_touched_ages();
+
+	void rebuild_filter();
+
+	void preserve(size_t cell_id);
+
+	void preserve_all();
+
+	void collect_ages(std::vector<std::pair<unsigned int, Key>>& entries, unsigned int a, unsigned int b) const;
+
 };
@@ -0,0 +1,122 @@
+#include "hash_table.hpp"
+#include "key_hash.hpp"
+#include <algorithm>
+#include <coroutine>
+#include <exception>
+
+#if defined(_MSC_VER)
+#include <xmmintrin.h>
+#define HT_PREFETCH(p) _mm_prefetch(reinterpret_cast<const char*>(p), _MM_HINT_T0)
+#else
+#define HT_PREFETCH(p) __builtin_prefetch(p)
+#endif
+
+namespace {
+	// frames of finished lookups are kept for the next ones, so that a lookup doesn't allocate.
+	// All frames of probe have the same size, frames of other sizes aren't kept
+	struct FramePool {
+		size_t frame_size = 0;
+		std::vector<void*> frames;
+
+		~FramePool() {
+			for (void* frame : frames)
+				::operator delete(frame);
+		}
+	};
+
+	thread_local FramePool frame_pool;
+}
+
+struct HashTable::LookupTask {
+	struct promise_type {
+		LookupTask get_return_object() {
+			return LookupTask{ std::coroutine_handle<promise_type>::from_promise(*this) };
+		}
+
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		std::suspend_always final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+
+		static void* operator new(size_t size) {
+			if ((size == frame_pool.frame_size) && !frame_pool.frames.empty()) {
+				void* frame = frame_pool.frames.back();
+				frame_pool.frames.pop_back();
+				return frame;
+			}
+			return ::operator new(size);
+		}
+
+		static void operator delete(void* frame, size_t size) {
+			if (!frame_pool.frame_size)
+				frame_pool.frame_size = size;
+			if (size == frame_pool.frame_size)
+				frame_pool.frames.push_back(frame);
+			else
+				::operator delete(frame);
+		}
+	};
+
+	std::coroutine_handle<promise_type> handle;
+};
+
+// suspends after prefetching every pointer it is going to follow: the bucket, the list and each node
+HashTable::LookupTask HashTable::probe(const Key& k, const Value*& result) const {
+	result = nullptr;
+	if (_filter.counters.enabled() && !_filter.counters.may_contain(calc_key_hash(k)))
+		co_return;
+
+	std::list<Cell>* const& bucket = _storage[calc_hash(k)];
+	HT_PREFETCH(&bucket);
+	co_await std::suspend_always();
+
+	std::list<Cell>* list = bucket;
+	if (!list)
+		co_return;
+	HT_PREFETCH(list);
+	co_await std::suspend_always();
+
+	for (auto it = list->begin(); it != list->end(); ++it) {
+		HT_PREFETCH(&*it);
+		co_await std::suspend_always();
+		if (it->key != k)
+			continue;
+		if (_expiry.enabled && (it->expires <= Clock::now()))
+			co_return;
+		touch(const_cast<Cell*>(&*it));
+		result = &it->val;
+		co_return;
+	}
+}
+
+std::vector<const Value*> HashTable::find_interleaved(const std::vector<Key>& keys, size_t group_size) const {
+	std::vector<const Value*> results(keys.size(), nullptr);
+	std::vector<std::coroutine_handle<LookupTask::promise_type>> group;
+	group_size = std::max<size_t>(group_size, 1);
+	group.reserve(group_size);
+
+	size_t next = 0;
+	for (; (next < keys.size()) && (group.size() < group_size); ++next)
+		group.push_back(probe(keys[next], results[next]).handle);
+
+	while (!group.empty()) {
+		for (size_t i = 0; i < group.size();) {
+			group[i].resume();
+			if (!group[i].done()) {
+				++i;
+				continue;
+			}
+			group[i].destroy();
+			if (next < keys.size()) {
+				group[i] = probe(keys[next], results[next]).handle;
+				++next;
+				++i;
+			}
+			else {
+				group[i] = group.back();
+				group.pop_back();
+			}
+		}
+	}
+	return results;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// finalizer of splitmix64: every bit of the result depends on every bit of x
+inline uint64_t mix_hash(uint64_t x) {
+	x += 0x9e3779b97f4a7c15ULL;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+// FNV-1a finished by mix_hash, so that both halves of the hash are evenly distributed.
+// Unlike the bucket hash of HashTable it takes no division per character
+inline uint64_t calc_key_hash(const std::string& k, uint64_t seed = 0) {
+	uint64_t hash = 0xcbf29ce484222325ULL ^ mix_hash(seed);
+	for (unsigned char x : k) {
+		hash ^= x;
+		hash *= 0x100000001b3ULL;
+	}
+	return mix_hash(hash);
+}
+
+// one-byte tags of the slots of open addressing HTs. Tags of used slots have the highest bit set
+// and keep 7 more bits of the hash, so that most slots of other keys are skipped by the tag alone
+constexpr uint8_t TAG_FREE = 0;
+constexpr uint8_t TAG_USED = 0x80;
+
+inline uint8_t calc_tag(uint64_t hash) {
+	return static_cast<uint8_t>(TAG_USED | (hash >> 57));
+}
@@ -0,0 +1,110 @@
+#include "large_array_allocator.hpp"
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	std::atomic<bool> huge_pages(false);
+	std::atomic<bool> interleave(false);
+	std::atomic<size_t> mapped_bytes(0);
+
+#ifdef __linux__
+	const size_t HUGE_PAGE_BYTES = size_t(2) << 20;
+	const int MPOL_INTERLEAVE = 3;
+	const size_t MAX_NODES = 64;
+
+	// parses the list of online nodes, like "0-1,3". Returns 0 if it can't be read
+	uint64_t online_nodes() {
+		std::ifstream in("/sys/devices/system/node/online");
+		std::string list;
+		if (!(in >> list))
+			return 0;
+		uint64_t mask = 0;
+		size_t pos = 0;
+		while (pos < list.size()) {
+			size_t end = list.find(',', pos);
+			if (end == std::string::npos)
+				end = list.size();
+			std::string range = list.substr(pos, end - pos);
+			size_t dash = range.find('-');
+			try {
+				size_t first = std::stoul(range.substr(0, dash));
+				size_t last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+				for (size_t node = first; (node <= last) && (node < MAX_NODES); ++node)
+					mask |= uint64_t(1) << node;
+			}
+			catch (const std::exception&) {
+				return 0;
+			}
+			pos = end + 1;
+		}
+		return mask;
+	}
+
+	size_t round_up(size_t bytes) {
+		return (bytes + HUGE_PAGE_BYTES - 1) / HUGE_PAGE_BYTES * HUGE_PAGE_BYTES;
+	}
+#endif
+}
+
+void set_memory_policy(const MemoryPolicy& policy) {
+	huge_pages = policy.huge_pages;
+	interleave = policy.interleave;
+}
+
+MemoryPolicy memory_policy() {
+	MemoryPolicy policy;
+	policy.huge_pages = huge_pages;
+	policy.interleave = interleave;
+	return policy;
+}
+
+// maps one huge page more than needed and unmaps the unaligned head and tail. The advices are
+// given before the array is touched, so that the pages are placed right from the start
+void* allocate_large_array(size_t bytes) {
+#ifdef __linux__
+	if (bytes >= LARGE_ARRAY_BYTES) {
+		size_t size = round_up(bytes);
+		void* mapped = mmap(nullptr, size + HUGE_PAGE_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mapped == MAP_FAILED)
+			throw std::bad_alloc();
+		uintptr_t begin = reinterpret_cast<uintptr_t>(mapped);
+		uintptr_t aligned = (begin + HUGE_PAGE_BYTES - 1) / HUGE_PAGE_BYTES * HUGE_PAGE_BYTES;
+		if (aligned != begin)
+			munmap(mapped, aligned - begin);
+		if (aligned + size != begin + size + HUGE_PAGE_BYTES)
+			munmap(reinterpret_cast<void*>(aligned + size), begin + HUGE_PAGE_BYTES - aligned);
+
+		void* p = reinterpret_cast<void*>(aligned);
+		if (huge_pages)
+			madvise(p, size, MADV_HUGEPAGE);
+		uint64_t nodes = interleave ? online_nodes() : 0;
+		if (nodes & (nodes - 1))
+			syscall(SYS_mbind, p, size, MPOL_INTERLEAVE, &nodes, MAX_NODES + 1, 0);
+		mapped_bytes += size;
+		return p;
+	}
+#endif
+	return ::operator new(bytes);
+}
+
+void free_large_array(void* p, size_t bytes) {
+#ifdef __linux__
+	if (bytes >= LARGE_ARRAY_BYTES) {
+		munmap(p, round_up(bytes));
+		mapped_bytes -= round_up(bytes);
+		return;
+	}
+#endif
+	::operator delete(p);
+}
+
+size_t large_array_bytes() {
+	return mapped_bytes;
+}
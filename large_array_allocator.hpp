@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <new>
+
+// where large arrays of the process (bucket arrays of HT, slot arrays of frozen HT) are placed.
+// Applies to arrays allocated after the call
+struct MemoryPolicy {
+	// back large arrays with 2MB transparent huge pages, if the kernel supports them
+	bool huge_pages = false;
+	// spread pages of large arrays over all NUMA nodes instead of the node of the first touch
+	bool interleave = false;
+};
+
+void set_memory_policy(const MemoryPolicy& policy);
+
+MemoryPolicy memory_policy();
+
+// arrays of at least LARGE_ARRAY_BYTES are mapped separately, aligned to a huge page, and
+// advised according to the memory policy. When an advice isn't supported, the array just stays
+// on ordinary pages. Smaller arrays come from operator new
+const size_t LARGE_ARRAY_BYTES = size_t(2) << 20;
+
+void* allocate_large_array(size_t bytes);
+
+void free_large_array(void* p, size_t bytes);
+
+// returns the amount of bytes currently mapped for large arrays, which operator new doesn't see
+size_t large_array_bytes();
+
+template <class T>
+class LargeArrayAllocator {
+public:
+	typedef T value_type;
+
+	LargeArrayAllocator() = default;
+
+	template <class U>
+	LargeArrayAllocator(const LargeArrayAllocator<U>&) {}
+
+	T* allocate(size_t n) {
+		if (n > size_t(-1) / sizeof(T))
+			throw std::bad_array_new_length();
+		return static_cast<T*>(allocate_large_array(n * sizeof(T)));
+	}
+
+	void deallocate(T* p, size_t n) {
+		free_large_array(p, n * sizeof(T));
+	}
+
+	template <class U>
+	bool operator==(const LargeArrayAllocator<U>&) const { return true; }
+
+	template <class U>
+	bool operator!=(const LargeArrayAllocator<U>&) const { return false; }
+};
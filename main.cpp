@@ -1,10 +1,264 @@
 #include "hash_table.hpp"
+#include "cuckoo_hash_table.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
 
-int main() {
-	HashTable A;
-	A.insert("jgfkhgjfj", Value("", 99));
-	A.erase("jgfkhgjfj");
-	std::cout << A.empty();
+namespace {
+	typedef std::chrono::steady_clock Clock;
+
+	// std::unordered_map behind the interface of HT, as a baseline for replays
+	class StdEngine {
+	public:
+		bool insert(const Key& k, const Value& v) {
+			return _map.insert_or_assign(k, v).second;
+		}
+
+		bool insert(const Key& k, const Value& v, Clock::duration) {
+			return insert(k, v);
+		}
+
+		bool erase(const Key& k) {
+			return _map.erase(k) != 0;
+		}
+
+		bool contains(const Key& k) const {
+			return _map.count(k) != 0;
+		}
+
+		Value& at(const Key& k) {
+			return _map.at(k);
+		}
+
+		Value& operator[](const Key& k) {
+			return _map.try_emplace(k, "").first->second;
+		}
+
+		void clear() {
+			_map.clear();
+		}
+	private:
+		std::unordered_map<Key, Value> _map;
+	};
+
+	// cuckoo HT has no expiry, so cells inserted with a TTL are replayed as plain inserts
+	class CuckooEngine : public CuckooHashTable {
+	public:
+		using CuckooHashTable::insert;
+
+		bool insert(const Key& k, const Value& v, Clock::duration) {
+			return insert(k, v);
+		}
+	};
+
+	// latencies fall into buckets 1/16 of a power of two wide, so that percentiles take
+	// constant memory however long the trace is, and are off by less than 1/16
+	class LatencyHistogram {
+	public:
+		void add(uint64_t ns) {
+			++_counts[bucket(ns)];
+			++_total;
+			_max = std::max(_max, ns);
+		}
+
+		// returns the upper bound of the bucket holding the p-th share of latencies
+		uint64_t percentile(double p) const {
+			uint64_t rank = static_cast<uint64_t>(p * (_total - 1));
+			uint64_t seen = 0;
+			for (size_t i = 0; i < _counts.size(); ++i) {
+				seen += _counts[i];
+				if (seen > rank)
+					return std::min(upper_bound(i), _max);
+			}
+			return _max;
+		}
+
+		uint64_t max() const {
+			return _max;
+		}
+
+		uint64_t total() const {
+			return _total;
+		}
+	private:
+		static const size_t SUB_BUCKETS = 16;
+		static const size_t SUB_BITS = 4;
+
+		std::vector<uint64_t> _counts = std::vector<uint64_t>(64 * SUB_BUCKETS, 0);
+		uint64_t _total = 0;
+		uint64_t _max = 0;
+
+		static size_t bucket(uint64_t ns) {
+			if (ns < SUB_BUCKETS)
+				return ns;
+			size_t shift = std::bit_width(ns) - 1 - SUB_BITS;
+			return (shift + 1) * SUB_BUCKETS + ((ns >> shift) & (SUB_BUCKETS - 1));
+		}
+
+		static uint64_t upper_bound(size_t i) {
+			if (i < SUB_BUCKETS)
+				return i;
+			size_t shift = i / SUB_BUCKETS - 1;
+			return ((SUB_BUCKETS + i % SUB_BUCKETS + 1) << shift) - 1;
+		}
+	};
+
+	template <class Engine>
+	void apply(Engine& engine, const TraceOp& op) {
+		switch (op.type) {
+		case TraceOp::INSERT:
+			engine.insert(op.key, Value(op.name, op.age));
+			break;
+		case TraceOp::INSERT_TTL:
+			engine.insert(op.key, Value(op.name, op.age), op.ttl);
+			break;
+		case TraceOp::ERASE:
+			engine.erase(op.key);
+			break;
+		case TraceOp::CONTAINS:
+			engine.contains(op.key);
+			break;
+		case TraceOp::AT:
+			try {
+				engine.at(op.key);
+			}
+			catch (const std::out_of_range&) {
+			}
+			break;
+		case TraceOp::SUBSCRIPT:
+			engine[op.key];
+			break;
+		case TraceOp::CLEAR:
+			engine.clear();
+			break;
+		}
+	}
+
+	// the resident memory of the process right now, from /proc where there is one
+	long rss_kb() {
+#ifndef _WIN32
+		std::ifstream statm("/proc/self/statm");
+		long pages = 0, resident = 0;
+		if (statm >> pages >> resident)
+			return resident * (sysconf(_SC_PAGESIZE) / 1024);
+#endif
+		return -1;
+	}
+
+	// the peak resident memory of the process: VmHWM from /proc where there is one, as it can be
+	// reset by reset_peak_rss, and ru_maxrss otherwise
+	long peak_rss_kb() {
+#ifndef _WIN32
+		std::ifstream status("/proc/self/status");
+		std::string line;
+		while (std::getline(status, line)) {
+			if (line.rfind("VmHWM:", 0) == 0)
+				return std::stol(line.substr(6));
+		}
+		rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) == 0)
+			return usage.ru_maxrss;
+#endif
+		return -1;
+	}
+
+	// lowers the peak to the current RSS. Returns false if the peak can't be reset
+	bool reset_peak_rss() {
+#ifndef _WIN32
+		std::ofstream clear_refs("/proc/self/clear_refs");
+		return static_cast<bool>(clear_refs << "5" << std::flush);
+#else
+		return false;
+#endif
+	}
+
+	// ops are read from the trace one by one, so that the memory of the process grows
+	// with the engine only, and the peak RSS of the replay is reported above the RSS before it
+	template <class Engine>
+	void replay(const std::string& path) {
+		std::ifstream in(path, std::ios::binary);
+		if (!in)
+			throw std::runtime_error("can't open " + path);
+		TraceReader reader(in);
+		bool peak_reset = reset_peak_rss();
+		long rss_before = rss_kb();
+
+		Engine engine;
+		LatencyHistogram latencies;
+		double seconds = 0;
+		TraceOp op;
+		while (reader.read(op)) {
+			auto op_start = Clock::now();
+			apply(engine, op);
+			auto op_time = Clock::now() - op_start;
+			seconds += std::chrono::duration<double>(op_time).count();
+			latencies.add(std::chrono::duration_cast<std::chrono::nanoseconds>(op_time).count());
+		}
+
+		std::cout << latencies.total() << " ops in " << seconds << " s";
+		if (seconds > 0)
+			std::cout << ", " << latencies.total() / seconds << " ops/s";
+		std::cout << "\n";
+		if (latencies.total()) {
+			std::cout << "latency, ns:";
+			for (double p : { 0.5, 0.9, 0.99, 0.999 })
+				std::cout << " p" << p * 100 << " " << latencies.percentile(p);
+			std::cout << " max " << latencies.max() << "\n";
+		}
+		long peak = peak_rss_kb();
+		if ((peak >= 0) && (rss_before >= 0)) {
+			std::cout << "peak RSS: " << std::max(peak - rss_before, 0L) << " KB above " << rss_before << " KB before the replay";
+			if (!peak_reset)
+				std::cout << ", the peak may be older than the replay";
+			std::cout << "\n";
+		}
+	}
+
+	void demo() {
+		HashTable A;
+		A.insert("jgfkhgjfj", Value("", 99));
+		A.erase("jgfkhgjfj");
+		std::cout << A.empty();
+	}
+}
+
+// usage: HashTable replay <trace> [chained|cuckoo|std]
+// without arguments runs the demo
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		demo();
+		return 0;
+	}
+
+	std::string mode = argv[1];
+	std::string engine = argc > 3 ? argv[3] : "chained";
+	if ((mode != "replay") || (argc < 3) || ((engine != "chained") && (engine != "cuckoo") && (engine != "std"))) {
+		std::cerr << "usage: " << argv[0] << " replay <trace> [chained|cuckoo|std]\n";
+		return 1;
+	}
+
+	try {
+		if (engine == "chained")
+			replay<HashTable>(argv[2]);
+		else if (engine == "cuckoo")
+			replay<CuckooEngine>(argv[2]);
+		else
+			replay<StdEngine>(argv[2]);
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << "\n";
+		return 1;
+	}
 	return 0;
 }
@@ -0,0 +1,144 @@
+#include "hash_table.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+// snapshots are registered by weak references, so that releasing the last copy of a snapshot
+// frees its buckets right away, and the writer just forgets it on the next change
+struct HashTable::Versions {
+	std::mutex mutex;
+	std::vector<std::weak_ptr<Snapshot::State>> snapshots;
+};
+
+// buckets holds the copies of the buckets changed since the snapshot was taken, nullptr for
+// a bucket which was empty. Other buckets are read from HT, until the snapshot is detached
+// from it by preserve_all. A detached snapshot holds copies of all its non-empty buckets
+struct HashTable::Snapshot::State {
+	std::shared_ptr<Versions> versions;
+	const HashTable* table = nullptr;
+	bool detached = false;
+	size_t capacity = 0;
+	size_t size = 0;
+	bool expiry = false;
+	Clock::time_point taken;
+	std::unordered_map<size_t, std::shared_ptr<const std::list<Cell>>> buckets;
+
+	// versions->mutex must be locked
+	const Cell* find(const Key& k) const;
+};
+
+const HashTable::Cell* HashTable::Snapshot::State::find(const Key& k) const {
+	size_t cell_id = calc_prime_hash(k) % capacity;
+	const std::list<Cell>* list = nullptr;
+	auto copy = buckets.find(cell_id);
+	if (copy != buckets.end())
+		list = copy->second.get();
+	else if (!detached)
+		list = table->_storage[cell_id];
+	if (!list)
+		return nullptr;
+
+	auto it = std::find_if(list->begin(), list->end(), [&k](const Cell& c) { return c.key == k; });
+	if ((it == list->end()) || (expiry && (it->expires <= taken)))
+		return nullptr;
+	return &*it;
+}
+
+bool HashTable::Snapshot::contains(const Key& k) const {
+	std::lock_guard<std::mutex> lock(_state->versions->mutex);
+	return _state->find(k) != nullptr;
+}
+
+Value HashTable::Snapshot::at(const Key& k) const {
+	std::lock_guard<std::mutex> lock(_state->versions->mutex);
+	const Cell* c = _state->find(k);
+	if (c == nullptr)
+		throw std::out_of_range("at threw to you \"out of range\"-exception");
+	return c->val;
+}
+
+size_t HashTable::Snapshot::size() const {
+	return _state->size;
+}
+
+bool HashTable::Snapshot::empty() const {
+	return _state->size == 0;
+}
+
+HashTable::Snapshot HashTable::snapshot() {
+	if (!_versions)
+		_versions = std::make_shared<Versions>();
+
+	Snapshot result;
+	result._state = std::make_shared<Snapshot::State>();
+	result._state->versions = _versions;
+	result._state->table = this;
+	result._state->capacity = _storage.size();
+	result._state->size = _size;
+	result._state->expiry = _expiry.enabled;
+	result._state->taken = Clock::now();
+
+	std::lock_guard<std::mutex> lock(_versions->mutex);
+	auto& snapshots = _versions->snapshots;
+	snapshots.erase(std::remove_if(snapshots.begin(), snapshots.end(),
+		[](const std::weak_ptr<Snapshot::State>& s) { return s.expired(); }), snapshots.end());
+	snapshots.push_back(result._state);
+	return result;
+}
+
+// a bucket is copied by the newest snapshot first, so once the newest one has it, all the older
+// ones have it as well. The same copy is shared by all the snapshots which didn't have the bucket
+void HashTable::preserve(size_t cell_id) {
+	if (!_versions)
+		return;
+
+	bool released = true;
+	{
+		std::lock_guard<std::mutex> lock(_versions->mutex);
+		std::shared_ptr<const std::list<Cell>> copy;
+		bool copied = false;
+		auto& snapshots = _versions->snapshots;
+		for (auto it = snapshots.rbegin(); it != snapshots.rend(); ++it) {
+			std::shared_ptr<Snapshot::State> s = it->lock();
+			if (!s)
+				continue;
+			released = false;
+			if (s->detached || s->buckets.count(cell_id))
+				break;
+			if (!copied) {
+				if (_storage[cell_id])
+					copy = std::make_shared<const std::list<Cell>>(*_storage[cell_id]);
+				copied = true;
+			}
+			s->buckets.emplace(cell_id, copy);
+		}
+	}
+	if (released)
+		_versions.reset();
+}
+
+// detached snapshots never read HT again, so HT forgets them
+void HashTable::preserve_all() {
+	if (!_versions)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(_versions->mutex);
+		std::vector<std::shared_ptr<const std::list<Cell>>> copies(_storage.size());
+		for (const auto& weak : _versions->snapshots) {
+			std::shared_ptr<Snapshot::State> s = weak.lock();
+			if (!s || s->detached)
+				continue;
+			for (size_t i = 0; i < _storage.size(); ++i) {
+				if (!_storage[i] || s->buckets.count(i))
+					continue;
+				if (!copies[i])
+					copies[i] = std::make_shared<const std::list<Cell>>(*_storage[i]);
+				s->buckets.emplace(i, copies[i]);
+			}
+			s->detached = true;
+			s->table = nullptr;
+		}
+		_versions->snapshots.clear();
+	}
+	_versions.reset();
+}
@@ -0,0 +1,225 @@
+#include "spill_hash_table.hpp"
+#include "key_hash.hpp"
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+	void put_u32(std::string& out, uint32_t x) {
+		char bytes[sizeof(x)];
+		std::memcpy(bytes, &x, sizeof(x));
+		out.append(bytes, sizeof(x));
+	}
+
+	uint32_t get_u32(const std::string& in, size_t& pos) {
+		if (pos + sizeof(uint32_t) > in.size())
+			throw std::runtime_error("corrupted spill segment");
+		uint32_t x;
+		std::memcpy(&x, in.data() + pos, sizeof(x));
+		pos += sizeof(x);
+		return x;
+	}
+
+	void put_string(std::string& out, const std::string& s) {
+		put_u32(out, static_cast<uint32_t>(s.size()));
+		out += s;
+	}
+
+	std::string get_string(const std::string& in, size_t& pos) {
+		size_t size = get_u32(in, pos);
+		if (pos + size > in.size())
+			throw std::runtime_error("corrupted spill segment");
+		std::string s = in.substr(pos, size);
+		pos += size;
+		return s;
+	}
+}
+
+SpillHashTable::SpillHashTable(const std::string& path, size_t memory_budget, size_t partitions) :
+	_path(path), _file(path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc),
+	_budget(memory_budget), _partitions(std::max<size_t>(partitions, 1)) {
+	if (!_file)
+		throw std::runtime_error("can't open spill file " + path);
+}
+
+SpillHashTable::~SpillHashTable() {
+	for (Partition& p : _partitions)
+		delete p.cells;
+	_file.close();
+	std::remove(_path.c_str());
+}
+
+size_t SpillHashTable::calc_bytes(const Key& k, const Value& v) {
+	return CELL_OVERHEAD + k.size() + v.name.size();
+}
+
+std::string SpillHashTable::read_segment(uint64_t offset, uint64_t length) {
+	std::string data(length, '\0');
+	_file.seekg(offset);
+	if (!_file.read(data.data(), length))
+		throw std::runtime_error("can't read spill file " + _path);
+	++_stats.reads;
+	_stats.bytes_read += length;
+	return data;
+}
+
+uint64_t SpillHashTable::write_segment(const std::string& data) {
+	uint64_t offset = _file_end;
+	_file.seekp(offset);
+	if (!_file.write(data.data(), data.size()))
+		throw std::runtime_error("can't write spill file " + _path);
+	_file_end += data.size();
+	++_stats.writes;
+	_stats.bytes_written += data.size();
+	return offset;
+}
+
+// a partition which wasn't changed since it was read keeps its segment and is just dropped
+void SpillHashTable::spill(Partition& p) {
+	if (p.dirty || !p.on_disk) {
+		if (p.on_disk)
+			_live_bytes -= p.length;
+		std::string data;
+		put_u32(data, static_cast<uint32_t>(p.cells->size()));
+		p.cells->for_each([&data](const Key& k, const Value& v) {
+			put_string(data, k);
+			put_string(data, v.name);
+			put_u32(data, v.age);
+		});
+		p.offset = write_segment(data);
+		p.length = data.size();
+		p.on_disk = true;
+		_live_bytes += p.length;
+	}
+
+	_resident_bytes -= p.bytes;
+	delete p.cells;
+	p.cells = nullptr;
+	p.dirty = false;
+	--_resident_partitions;
+
+	if ((_file_end >= MIN_COMPACT_BYTES) && (_file_end > 2 * _live_bytes))
+		compact();
+}
+
+SpillHashTable::Partition& SpillHashTable::load(const Key& k) {
+	Partition& p = _partitions[calc_key_hash(k) % _partitions.size()];
+	p.referenced = true;
+	if (p.cells)
+		return p;
+
+	p.cells = new HashTable;
+	p.bytes = 0;
+	++_resident_partitions;
+	if (p.on_disk) {
+		std::string data = read_segment(p.offset, p.length);
+		size_t pos = 0;
+		size_t count = get_u32(data, pos);
+		for (size_t i = 0; i < count; ++i) {
+			Key key = get_string(data, pos);
+			std::string name = get_string(data, pos);
+			Value val(name, get_u32(data, pos));
+			p.bytes += calc_bytes(key, val);
+			p.cells->insert(key, val);
+		}
+	}
+	_resident_bytes += p.bytes;
+	fit_budget(p);
+	return p;
+}
+
+void SpillHashTable::fit_budget(const Partition& keep) {
+	while ((_resident_bytes > _budget) && (_resident_partitions > 1)) {
+		if (_clock_hand >= _partitions.size())
+			_clock_hand = 0;
+		Partition& p = _partitions[_clock_hand++];
+		if (!p.cells || (&p == &keep))
+			continue;
+		if (p.referenced) {
+			p.referenced = false;
+			continue;
+		}
+		spill(p);
+	}
+}
+
+// stale segments are dropped by copying the live ones into a new file, which replaces the old one
+void SpillHashTable::compact() {
+	std::string new_path = _path + ".compact";
+	std::fstream new_file(new_path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!new_file)
+		throw std::runtime_error("can't open spill file " + new_path);
+
+	uint64_t new_end = 0;
+	for (Partition& p : _partitions) {
+		if (!p.on_disk)
+			continue;
+		std::string data = read_segment(p.offset, p.length);
+		if (!new_file.write(data.data(), data.size()))
+			throw std::runtime_error("can't write spill file " + new_path);
+		++_stats.writes;
+		_stats.bytes_written += data.size();
+		p.offset = new_end;
+		new_end += data.size();
+	}
+
+	new_file.close();
+	_file.close();
+	if (std::remove(_path.c_str()) || std::rename(new_path.c_str(), _path.c_str()))
+		throw std::runtime_error("can't replace spill file " + _path);
+	_file.open(_path, std::ios::in | std::ios::out | std::ios::binary);
+	if (!_file)
+		throw std::runtime_error("can't open spill file " + _path);
+	_file_end = new_end;
+}
+
+bool SpillHashTable::insert(const Key& k, const Value& v) {
+	Partition& p = load(k);
+	size_t old_bytes = p.cells->contains(k) ? calc_bytes(k, p.cells->at(k)) : 0;
+	bool result = p.cells->insert(k, v);
+	size_t new_bytes = calc_bytes(k, v);
+	p.bytes += new_bytes - old_bytes;
+	_resident_bytes += new_bytes - old_bytes;
+	p.dirty = true;
+	if (result)
+		++_size;
+	fit_budget(p);
+	return result;
+}
+
+bool SpillHashTable::erase(const Key& k) {
+	Partition& p = load(k);
+	if (!p.cells->contains(k))
+		return false;
+	size_t bytes = calc_bytes(k, p.cells->at(k));
+	p.cells->erase(k);
+	p.bytes -= bytes;
+	_resident_bytes -= bytes;
+	p.dirty = true;
+	--_size;
+	return true;
+}
+
+bool SpillHashTable::contains(const Key& k) {
+	return load(k).cells->contains(k);
+}
+
+Value SpillHashTable::at(const Key& k) {
+	return load(k).cells->at(k);
+}
+
+size_t SpillHashTable::size() const {
+	return _size;
+}
+
+bool SpillHashTable::empty() const {
+	return _size == 0;
+}
+
+size_t SpillHashTable::resident_bytes() const {
+	return _resident_bytes;
+}
+
+SpillHashTable::Stats SpillHashTable::stats() const {
+	return _stats;
+}
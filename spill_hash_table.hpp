@@ -0,0 +1,94 @@
+#pragma once
+#include "hash_table.hpp"
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// HT for data sets larger than the memory. Keys are split by their hash into partitions, every
+// partition is a HT of its own. Partitions which don't fit into the memory budget are spilled
+// into segments of a file and are read back on the first access. Partitions are chosen for
+// spilling with the CLOCK policy, and a partition is only written when it was changed since
+// it was read, so all the changes made while it stayed in memory are written at once
+class SpillHashTable {
+public:
+	// I/O made by spill HT since its creation
+	struct Stats {
+		size_t reads = 0;
+		size_t writes = 0;
+		size_t bytes_read = 0;
+		size_t bytes_written = 0;
+	};
+
+	// creates an empty spill HT keeping about memory_budget bytes of cells in memory and spilling
+	// the rest into the file at path, which is created or truncated. The file is removed by
+	// the destructor. Throws std::runtime_error if the file can't be opened
+	SpillHashTable(const std::string& path, size_t memory_budget, size_t partitions = DEFAULT_PARTITIONS);
+
+	~SpillHashTable();
+
+	SpillHashTable(const SpillHashTable&) = delete;
+	SpillHashTable& operator=(const SpillHashTable&) = delete;
+
+	// the same as in HT. I/O errors are thrown as std::runtime_error
+	bool insert(const Key& k, const Value& v);
+	bool erase(const Key& k);
+	bool contains(const Key& k);
+
+	// returns a copy of the value, since the partition of the key may be spilled by the next call.
+	// Throws a std::out_of_range exception if spill HT doesn't contain the key
+	Value at(const Key& k);
+
+	// returns an actual amount of keys contained in spill HT
+	size_t size() const;
+
+	// returns false if spill HT size doesn't equal 0. If it does, returns true
+	bool empty() const;
+
+	// returns an estimated amount of bytes taken by the partitions kept in memory
+	size_t resident_bytes() const;
+
+	Stats stats() const;
+private:
+	static const size_t DEFAULT_PARTITIONS = 4096;
+	static const size_t CELL_OVERHEAD = 96;
+	// the file is rewritten without stale segments when they take more than a half of it
+	static const uint64_t MIN_COMPACT_BYTES = 1 << 20;
+
+	struct Partition {
+		HashTable* cells = nullptr;
+		size_t bytes = 0;
+		uint64_t offset = 0;
+		uint64_t length = 0;
+		bool on_disk = false;
+		bool dirty = false;
+		bool referenced = false;
+	};
+
+	std::string _path;
+	std::fstream _file;
+	uint64_t _file_end = 0;
+	uint64_t _live_bytes = 0;
+
+	size_t _budget;
+	size_t _resident_bytes = 0;
+	size_t _resident_partitions = 0;
+	size_t _size = 0;
+	size_t _clock_hand = 0;
+	std::vector<Partition> _partitions;
+	Stats _stats;
+
+	static size_t calc_bytes(const Key& k, const Value& v);
+
+	Partition& load(const Key& k);
+
+	void spill(Partition& p);
+
+	void fit_budget(const Partition& keep);
+
+	std::string read_segment(uint64_t offset, uint64_t length);
+
+	uint64_t write_segment(const std::string& data);
+
+	void compact();
+};
@@ -1,5 +1,16 @@
 #include "hash_table.hpp"
+#include "frozen_hash_table.hpp"
+#include "columnar_hash_table.hpp"
+#include "cuckoo_hash_table.hpp"
+#include "key_hash.hpp"
+#include "spill_hash_table.hpp"
+#include "trace.hpp"
 #include "gtest/gtest.h"
+#include <atomic>
+#include <climits>
+#include <filesystem>
+#include <random>
+#include <thread>
 
 
 namespace testing_constants {
@@ -12,7 +23,8 @@ bool operator==(const Value& a, const Value& b) {
 	return a.age == b.age && a.name == b.name;
 }
 
-std::vector<std::pair<Key, Value>> add_100_entries(HashTable& HT) {
+template <typename Table>
+std::vector<std::pair<Key, Value>> add_100_entries(Table& HT) {
 	std::vector<std::pair<Key, Value>> inserted;
 	Key key;
 	for (int i = 1; i <= 100; ++i) {
@@ -26,7 +38,8 @@ std::vector<std::pair<Key, Value>> add_100_entries(HashTable& HT) {
 	return inserted;
 }
 
-std::vector<std::pair<Key, Value>> many_equal_hashes(HashTable& HT) {
+template <typename Table>
+std::vector<std::pair<Key, Value>> many_equal_hashes(Table& HT) {
 	std::vector<std::pair<Key, Value>> result;
 	Key key;
 	key = "\001\002";
@@ -41,10 +54,85 @@ std::vector<std::pair<Key, Value>> many_equal_hashes(HashTable& HT) {
 	return result;
 }
 
+// the basic checks run against every storage engine
+typedef ::testing::Types<HashTable, CuckooHashTable> Engines;
+
+class EngineNames {
+public:
+	template <typename T>
+	static std::string GetName(int) {
+		return std::is_same_v<T, HashTable> ? "chained" : "cuckoo";
+	}
+};
+
+template <typename T>
+class SwapCheck : public ::testing::Test {};
+TYPED_TEST_SUITE(SwapCheck, Engines, EngineNames);
+
+template <typename T>
+class InsertCheck : public ::testing::Test {};
+TYPED_TEST_SUITE(InsertCheck, Engines, EngineNames);
+
+template <typename T>
+class CopyConstuctorCheck : public ::testing::Test {};
+TYPED_TEST_SUITE(CopyConstuctorCheck, Engines, EngineNames);
+
+template <typename T>
+class CopyConstructorCheck : public ::testing::Test {};
+TYPED_TEST_SUITE(CopyConstructorCheck, Engines, EngineNames);
+
+template <typename T>
+class ClearCheck : public ::testing::Test {};
+TYPED_TEST_SUITE(ClearCheck, Engines, EngineNames);
+
+template <typename T>
+class EraseCheck : public ::testing::Test {};
+TYPED_TEST_SUITE(EraseCheck, Engines, EngineNames);
+
+template <typename T>
+class ContainsCheck : public ::testing::Test {};
+TYPED_TEST_SUITE(ContainsCheck, Engines, EngineNames);
+
+template <typename T>
+class SqBracketsCheck : public ::testing::Test {};
+TYPED_TEST_SUITE(SqBracketsCheck, Engines, EngineNames);
+
+template <typename T>
+class AtCheck : public ::testing::Test {};
+TYPED_TEST_SUITE(AtCheck, Engines, EngineNames);
+
+template <typename T>
+class ConstAtCheck : public ::testing::Test {};
+TYPED_TEST_SUITE(ConstAtCheck, Engines, EngineNames);
+
+template <typename T>
+class SizeCheck : public ::testing::Test {};
+TYPED_TEST_SUITE(SizeCheck, Engines, EngineNames);
+
+template <typename T>
+class EmptyCheck : public ::testing::Test {};
+TYPED_TEST_SUITE(EmptyCheck, Engines, EngineNames);
+
+template <typename T>
+class EqualityOpCheck : public ::testing::Test {};
+TYPED_TEST_SUITE(EqualityOpCheck, Engines, EngineNames);
+
+template <typename T>
+class AssignmentOpCheck : public ::testing::Test {};
+TYPED_TEST_SUITE(AssignmentOpCheck, Engines, EngineNames);
+
+template <typename T>
+class LargeTests : public ::testing::Test {};
+TYPED_TEST_SUITE(LargeTests, Engines, EngineNames);
+
+template <typename T>
+class ReserveCheck : public ::testing::Test {};
+TYPED_TEST_SUITE(ReserveCheck, Engines, EngineNames);
+
 //swap check
-TEST(SwapCheck, SwapTwoNonEmpty) {
-	HashTable A;
-	HashTable B;
+TYPED_TEST(SwapCheck, SwapTwoNonEmpty) {
+	TypeParam A;
+	TypeParam B;
 	A.insert("1", default_value);
 	A.insert("2", default_value);
 	B.insert("3", default_value);
@@ -56,16 +144,16 @@ TEST(SwapCheck, SwapTwoNonEmpty) {
 	EXPECT_EQ(A.size(), 1);
 }
 
-TEST(SwapCheck, SwapEmptyHTs) {
-	HashTable A;
-	HashTable B;
+TYPED_TEST(SwapCheck, SwapEmptyHTs) {
+	TypeParam A;
+	TypeParam B;
 	A.swap(B);
 	EXPECT_EQ(A.size(), 0);
 	EXPECT_EQ(B.size(), 0);
 }
 
-TEST(SwapCheck, SwapWithItself) {
-	HashTable A;
+TYPED_TEST(SwapCheck, SwapWithItself) {
+	TypeParam A;
 	A.swap(A);
 	EXPECT_EQ(A.size(), 0);
 	A.insert("1", default_value);
@@ -75,9 +163,9 @@ TEST(SwapCheck, SwapWithItself) {
 	EXPECT_EQ(A.at("1"), default_value);
 }
 
-TEST(SwapCheck, SwapEmptyWithNonEmpty) {
-	HashTable A;
-	HashTable B;
+TYPED_TEST(SwapCheck, SwapEmptyWithNonEmpty) {
+	TypeParam A;
+	TypeParam B;
 	A.insert("1", default_value);
 	A.insert("2", default_value);
 	A.swap(B);
@@ -90,15 +178,15 @@ TEST(SwapCheck, SwapEmptyWithNonEmpty) {
 
 //insert check
 
-TEST(InsertCheck, CheckValueAfterInsert) {
-	HashTable A;
+TYPED_TEST(InsertCheck, CheckValueAfterInsert) {
+	TypeParam A;
 	A.insert("a", Value("name", 21));
 	EXPECT_EQ(A.at("a"), Value("name", 21));
 	EXPECT_EQ(A.size(), 1);
 }
 
-TEST(InsertCheck, ExpandCorrectivityCheck) {
-	HashTable A;
+TYPED_TEST(InsertCheck, ExpandCorrectivityCheck) {
+	TypeParam A;
 	A.insert("f", Value("1", 1));
 	A.insert("g", Value("2", 2));
 	A.insert("h", Value("3", 3));
@@ -110,8 +198,8 @@ TEST(InsertCheck, ExpandCorrectivityCheck) {
 	EXPECT_EQ(A["i"], Value("4", 4));
 }
 
-TEST(InsertCheck, OneKeyTwiceSameValue) {
-	HashTable A;
+TYPED_TEST(InsertCheck, OneKeyTwiceSameValue) {
+	TypeParam A;
 	EXPECT_TRUE(A.insert("1", default_value));
 	EXPECT_EQ(A.at("1"), default_value);
 	EXPECT_EQ(A.size(), 1);
@@ -120,8 +208,8 @@ TEST(InsertCheck, OneKeyTwiceSameValue) {
 	EXPECT_EQ(A.size(), 1);
 }
 
-TEST(InsertCheck, SameKeyDifferentValue) {
-	HashTable A;
+TYPED_TEST(InsertCheck, SameKeyDifferentValue) {
+	TypeParam A;
 	EXPECT_TRUE(A.insert("pw", default_value));
 	EXPECT_EQ(A.at("pw"), default_value);
 	EXPECT_FALSE(A.insert("pw", Value("name", 9)));
@@ -129,50 +217,50 @@ TEST(InsertCheck, SameKeyDifferentValue) {
 }
 
 //copy constructor check
-TEST(CopyConstuctorCheck, CopyHT_SameSizesAndSameContent) {
-	HashTable A;
+TYPED_TEST(CopyConstuctorCheck, CopyHT_SameSizesAndSameContent) {
+	TypeParam A;
 	A.insert("1", default_value);
 	A.insert("2", default_value);
 	A.insert("3", default_value);
-	HashTable B = A;
+	TypeParam B = A;
 	EXPECT_EQ(B.size(), 3);
 	EXPECT_TRUE(B.contains("1"));
 	EXPECT_TRUE(B.contains("2"));
 	EXPECT_TRUE(B.contains("3"));
 }
 
-TEST(CopyConstuctorCheck, PtrsDOESNTinherited) {
-	HashTable A;
+TYPED_TEST(CopyConstuctorCheck, PtrsDOESNTinherited) {
+	TypeParam A;
 	A.insert("1", default_value);
-	HashTable B = A;
+	TypeParam B = A;
 	EXPECT_TRUE(&B["1"] != &A["1"]);
 }
 
-TEST(CopyConstuctorCheck, CopyEmptyHT) {
-	HashTable A;
-	HashTable B = A;
+TYPED_TEST(CopyConstuctorCheck, CopyEmptyHT) {
+	TypeParam A;
+	TypeParam B = A;
 	EXPECT_EQ(B.size(), 0);
 }
 
-TEST(CopyConstructorCheck, ChangingValueDoesntInfluenceToAnother) {
-	HashTable A;
+TYPED_TEST(CopyConstructorCheck, ChangingValueDoesntInfluenceToAnother) {
+	TypeParam A;
 	A.insert("1", default_value);
 	A.insert("2", default_value);
-	HashTable B = A;
+	TypeParam B = A;
 	A["1"] = Value("102", 120);
 	EXPECT_EQ(B["1"], default_value);
 }
 
 
 //clear check
-TEST(ClearCheck, EmptyHTCheck) {
-	HashTable A;
+TYPED_TEST(ClearCheck, EmptyHTCheck) {
+	TypeParam A;
 	A.clear();
 	EXPECT_EQ(A.size(), 0);
 }
 
-TEST(ClearCheck, EraseHTtoEmpty) {
-	HashTable A;
+TYPED_TEST(ClearCheck, EraseHTtoEmpty) {
+	TypeParam A;
 	A.insert("1", default_value);
 	A.insert("2", default_value);
 	A.insert("3", default_value);
@@ -186,8 +274,8 @@ TEST(ClearCheck, EraseHTtoEmpty) {
 }
 
 // erase check
-TEST(EraseCheck, DeleteFakeKey) {
-	HashTable A;
+TYPED_TEST(EraseCheck, DeleteFakeKey) {
+	TypeParam A;
 	A.insert("1", default_value);
 	EXPECT_FALSE(A.erase("2"));
 	EXPECT_EQ(A.size(), 1);
@@ -195,16 +283,16 @@ TEST(EraseCheck, DeleteFakeKey) {
 	EXPECT_EQ(A.at("1"), default_value);
 }
 
-TEST(EraseCheck, BasicCheck) {
-	HashTable A;
+TYPED_TEST(EraseCheck, BasicCheck) {
+	TypeParam A;
 	A.insert("1", default_value);
 	EXPECT_TRUE(A.erase("1"));
 	EXPECT_EQ(A.size(), 0);
 	EXPECT_FALSE(A.contains("1"));
 }
 
-TEST(EraseCheck, ReduceCheck) {
-	HashTable A;
+TYPED_TEST(EraseCheck, ReduceCheck) {
+	TypeParam A;
 	A.insert("a", default_value);
 	A.insert("b", default_value);
 	A.insert("c", default_value);
@@ -217,8 +305,8 @@ TEST(EraseCheck, ReduceCheck) {
 	EXPECT_EQ(A.at("b"), default_value);
 }
 
-TEST(EraseCheck, RetValueCheck) {
-	HashTable A;
+TYPED_TEST(EraseCheck, RetValueCheck) {
+	TypeParam A;
 	A.insert("1", default_value);
 	EXPECT_EQ(A.size(), 1);
 	EXPECT_TRUE(A.erase("1"));
@@ -227,8 +315,8 @@ TEST(EraseCheck, RetValueCheck) {
 	EXPECT_EQ(A.size(), 0);
 }
 
-TEST(EraseCheck, EqualHashesCheck) {
-	HashTable A;
+TYPED_TEST(EraseCheck, EqualHashesCheck) {
+	TypeParam A;
 	A.insert("\001", default_value);
 	A.insert("\021", default_value);
 	A.erase("\001");
@@ -237,24 +325,24 @@ TEST(EraseCheck, EqualHashesCheck) {
 	EXPECT_FALSE(A.contains("\001"));
 }
 
-TEST(EraseCheck, EraseKeyFromEmptyHT) {
-	HashTable A;
+TYPED_TEST(EraseCheck, EraseKeyFromEmptyHT) {
+	TypeParam A;
 	EXPECT_FALSE(A.erase("1"));
 	EXPECT_EQ(A.size(), 0);
 	EXPECT_FALSE(A.contains("1"));
 }
 
 // contains check
-TEST(ContainsCheck, DoContainTrueCell) {
-	HashTable A;
+TYPED_TEST(ContainsCheck, DoContainTrueCell) {
+	TypeParam A;
 	EXPECT_TRUE(A.insert("4", default_value));
 	EXPECT_TRUE(A.contains("4"));
 }
 
 // [] check
 
-TEST(SqBracketsCheck, ChangingSomeValueDoesntInfluenceTpAnother) {
-	HashTable A;
+TYPED_TEST(SqBracketsCheck, ChangingSomeValueDoesntInfluenceTpAnother) {
+	TypeParam A;
 	A.insert("1", default_value);
 	A.insert("2", default_value);
 	A["1"] = Value("122", 12);
@@ -262,88 +350,88 @@ TEST(SqBracketsCheck, ChangingSomeValueDoesntInfluenceTpAnother) {
 	EXPECT_EQ(A.at("1"), Value("122", 12));
 }
 
-TEST(SqBracketsCheck, NonExistingValueGivesDefaultValue) {
-	HashTable A;
+TYPED_TEST(SqBracketsCheck, NonExistingValueGivesDefaultValue) {
+	TypeParam A;
 	A.insert("1", Value("12121", 12121));
 	EXPECT_EQ(A["2"], default_value);
 }
 
-TEST(SqBracketsCheck, InsertDefaultValueWhenNoKeyInTable) {
-	HashTable A;
+TYPED_TEST(SqBracketsCheck, InsertDefaultValueWhenNoKeyInTable) {
+	TypeParam A;
 	A["a"];
 	EXPECT_EQ(A.size(), 1);
 	EXPECT_EQ(A.at("a"), default_value);
 }
 
-TEST(SqBracketsCheck, FindsCellAfterInsert) {
-	HashTable A;
+TYPED_TEST(SqBracketsCheck, FindsCellAfterInsert) {
+	TypeParam A;
 	A.insert("a", Value("21", 32));
 	EXPECT_EQ(A["a"], Value("21", 32));
 }
 
-TEST(SqBracketsCheck, InsertAndThenChangeValue) {
-	HashTable A;
+TYPED_TEST(SqBracketsCheck, InsertAndThenChangeValue) {
+	TypeParam A;
 	A.insert("t", default_value);
 	EXPECT_EQ(A["t"], default_value);
 	A["t"] = Value("namename", 10);
 	EXPECT_EQ(A.at("t"), Value("namename", 10));
 }
 
-TEST(SqBracketsCheck, Insert) {
-	HashTable A;
+TYPED_TEST(SqBracketsCheck, Insert) {
+	TypeParam A;
 	A["t"] = Value("namename", 10);
 	EXPECT_EQ(A.at("t"), Value("namename", 10));
 }
 
 // at check
-TEST(AtCheck, ThrowingCheck) {
-	HashTable A;
+TYPED_TEST(AtCheck, ThrowingCheck) {
+	TypeParam A;
 	EXPECT_THROW(A.at("1"), std::out_of_range);
 	A.insert("1", default_value);
 	EXPECT_EQ(A.at("1"), default_value);
 	EXPECT_THROW(A.at("2"), std::out_of_range);
 }
 
-TEST(AtCheck, TrueLoadCellCheck) {
-	HashTable A;
+TYPED_TEST(AtCheck, TrueLoadCellCheck) {
+	TypeParam A;
 	A.insert("a", Value("namename", 10));
 	EXPECT_EQ(A.at("a"), Value("namename", 10));
 	EXPECT_EQ(A.size(), 1);
 }
 
-TEST(AtCheck, ChangingTrueElem) {
-	HashTable A;
+TYPED_TEST(AtCheck, ChangingTrueElem) {
+	TypeParam A;
 	A.insert("t", default_value);
 	A.at("t") = Value("namename", 10);
 	EXPECT_EQ(A.at("t"), Value("namename", 10));
 }
 
-TEST(ConstAtCheck, ThrowingCheck) {
-	const HashTable B;
+TYPED_TEST(ConstAtCheck, ThrowingCheck) {
+	const TypeParam B;
 	EXPECT_THROW(B.at("1"), std::out_of_range);
-	HashTable A;
+	TypeParam A;
 	A.insert("1", default_value);
-	const HashTable C = A;
+	const TypeParam C = A;
 	EXPECT_EQ(C.at("1"), default_value);
 	EXPECT_THROW(C.at("2"), std::out_of_range);
 }
 
-TEST(ConstAtCheck, TrueLoadCellCheck) {
-	HashTable A;
+TYPED_TEST(ConstAtCheck, TrueLoadCellCheck) {
+	TypeParam A;
 	A.insert("a", Value("namename", 10));
-	const HashTable B = A;
+	const TypeParam B = A;
 	EXPECT_EQ(B.at("a"), Value("namename", 10));
 	EXPECT_EQ(A.size(), 1);
 }
 
 //size check
-TEST(SizeCheck, EmptyHTSize) {
-	HashTable A;
+TYPED_TEST(SizeCheck, EmptyHTSize) {
+	TypeParam A;
 	EXPECT_EQ(A.size(), 0);
 }
 
-TEST(SizeCheck, Inserting) {
-	HashTable A;
+TYPED_TEST(SizeCheck, Inserting) {
+	TypeParam A;
 	A.insert("1", default_value);
 	EXPECT_EQ(A.size(), 1);
 	A.insert("2", default_value);
@@ -363,19 +451,19 @@ TEST(SizeCheck, Inserting) {
 }
 
 // empty check
-TEST(EmptyCheck, EmptyHTCheck) {
-	HashTable A;
+TYPED_TEST(EmptyCheck, EmptyHTCheck) {
+	TypeParam A;
 	EXPECT_TRUE(A.empty());
 }
 
-TEST(EmptyCheck, NonEmptyHTCheck) {
-	HashTable A;
+TYPED_TEST(EmptyCheck, NonEmptyHTCheck) {
+	TypeParam A;
 	A.insert("1", default_value);
 	EXPECT_FALSE(A.empty());
 }
 
-TEST(EmptyCheck, ErasingToEmpty) {
-	HashTable A;
+TYPED_TEST(EmptyCheck, ErasingToEmpty) {
+	TypeParam A;
 	A.insert("1", default_value);
 	A.insert("2", default_value);
 	A.insert("3", default_value);
@@ -387,8 +475,8 @@ TEST(EmptyCheck, ErasingToEmpty) {
 	EXPECT_TRUE(A.empty());
 }
 
-TEST(EmptyCheck, ClearLeadsToEmpty) {
-	HashTable A;
+TYPED_TEST(EmptyCheck, ClearLeadsToEmpty) {
+	TypeParam A;
 	A.insert("1", default_value);
 	A.insert("2", default_value);
 	A.insert("3", default_value);
@@ -398,18 +486,18 @@ TEST(EmptyCheck, ClearLeadsToEmpty) {
 }
 
 // operator==
-TEST(EqualityOpCheck, EmptyTables) {
-	HashTable A, B;
+TYPED_TEST(EqualityOpCheck, EmptyTables) {
+	TypeParam A, B;
 	EXPECT_TRUE(A == B);
 }
 
-TEST(EqualityOpCheck, OnlyDifferentKeys) {
-	HashTable A;
+TYPED_TEST(EqualityOpCheck, OnlyDifferentKeys) {
+	TypeParam A;
 	A.insert("1", default_value);
 	A.insert("2", default_value);
 	A.insert("3", default_value);
 	A.insert("4", default_value);
-	HashTable B;
+	TypeParam B;
 	B.insert("a", default_value);
 	B.insert("b", default_value);
 	B.insert("c", default_value);
@@ -417,13 +505,13 @@ TEST(EqualityOpCheck, OnlyDifferentKeys) {
 	EXPECT_FALSE(A == B);
 }
 
-TEST(EqualityOpCheck, OnlyEqualKeys) {
-	HashTable A;
+TYPED_TEST(EqualityOpCheck, OnlyEqualKeys) {
+	TypeParam A;
 	A.insert("1", default_value);
 	A.insert("2", default_value);
 	A.insert("3", default_value);
 	A.insert("4", default_value);
-	HashTable B;
+	TypeParam B;
 	B.insert("1", default_value);
 	B.insert("2", default_value);
 	B.insert("3", default_value);
@@ -431,13 +519,13 @@ TEST(EqualityOpCheck, OnlyEqualKeys) {
 	EXPECT_TRUE(A == B);
 }
 
-TEST(EqualityOpCheck, EqualAndUnequalKeys) {
-	HashTable A;
+TYPED_TEST(EqualityOpCheck, EqualAndUnequalKeys) {
+	TypeParam A;
 	A.insert("1", default_value);
 	A.insert("2", default_value);
 	A.insert("3", default_value);
 	A.insert("4", default_value);
-	HashTable B;
+	TypeParam B;
 	B.insert("1", default_value);
 	B.insert("2", default_value);
 	B.insert("a", default_value);
@@ -445,13 +533,13 @@ TEST(EqualityOpCheck, EqualAndUnequalKeys) {
 	EXPECT_FALSE(A == B);
 }
 
-TEST(EqualityOpCheck, EqualKeysUnequalValues) {
-	HashTable A;
+TYPED_TEST(EqualityOpCheck, EqualKeysUnequalValues) {
+	TypeParam A;
 	A.insert("1", default_value);
 	A.insert("2", default_value);
 	A.insert("3", default_value);
 	A.insert("4", default_value);
-	HashTable B;
+	TypeParam B;
 	B.insert("1", default_value);
 	B.insert("2", default_value);
 	B.insert("3", Value("d", 21));
@@ -459,8 +547,8 @@ TEST(EqualityOpCheck, EqualKeysUnequalValues) {
 	EXPECT_FALSE(A == B);
 }
 
-TEST(EqualityOpCheck, Reflexivity) {
-	HashTable A;
+TYPED_TEST(EqualityOpCheck, Reflexivity) {
+	TypeParam A;
 	A.insert("1", Value("1", 2));
 	A.insert("2", Value("2", 3));
 	EXPECT_TRUE(A == A);
@@ -469,13 +557,13 @@ TEST(EqualityOpCheck, Reflexivity) {
 	EXPECT_EQ(A.at("2"), Value("2", 3));
 }
 
-TEST(EqualityOpCheck, Symmetry) {
-	HashTable A;
+TYPED_TEST(EqualityOpCheck, Symmetry) {
+	TypeParam A;
 	A.insert("1", default_value);
 	A.insert("2", default_value);
 	A.insert("3", default_value);
 	A.insert("4", default_value);
-	HashTable B;
+	TypeParam B;
 	B.insert("1", default_value);
 	B.insert("2", default_value);
 	B.insert("3", default_value);
@@ -487,14 +575,14 @@ TEST(EqualityOpCheck, Symmetry) {
 	EXPECT_TRUE(B != A);
 }
 
-TEST(EqualityOpCheck, Transitivity) {
-	HashTable A;
+TYPED_TEST(EqualityOpCheck, Transitivity) {
+	TypeParam A;
 	A.insert("1", default_value);
 	A.insert("2", default_value);
-	HashTable B;
+	TypeParam B;
 	B.insert("1", default_value);
 	B.insert("2", default_value);
-	HashTable C;
+	TypeParam C;
 	EXPECT_TRUE(A == B); 
 	EXPECT_TRUE(B != C); 
 	EXPECT_TRUE(A != C);
@@ -513,20 +601,20 @@ TEST(EqualityOpCheck, Transitivity) {
 	EXPECT_TRUE(A != C);
 }
 
-TEST(EqualityOpCheck, DiffSizes) {
-	HashTable A;
-	HashTable B;
+TYPED_TEST(EqualityOpCheck, DiffSizes) {
+	TypeParam A;
+	TypeParam B;
 	B.insert("1", default_value);
 	EXPECT_FALSE(A == B);
 }
 
-TEST(EqualityOpCheck, DiffCapacitiesSameEntries) {
-	HashTable A;
+TYPED_TEST(EqualityOpCheck, DiffCapacitiesSameEntries) {
+	TypeParam A;
 	A.insert("1", Value("name2", 21));
 	A.insert("2", default_value);
 	A.insert("3", default_value);
 	A.insert("4", default_value); //expand
-	HashTable B;
+	TypeParam B;
 	B.insert("1", Value("name2", 21));
 	EXPECT_FALSE(A == B);
 	A.erase("2");
@@ -536,8 +624,8 @@ TEST(EqualityOpCheck, DiffCapacitiesSameEntries) {
 }
 
  // assignment check
-TEST(AssignmentOpCheck, AssignmentToItself) {
-	HashTable A;
+TYPED_TEST(AssignmentOpCheck, AssignmentToItself) {
+	TypeParam A;
 	A = A;
 	EXPECT_EQ(A.size(), 0);
 	A.insert("1", Value("foo", 1));
@@ -546,10 +634,10 @@ TEST(AssignmentOpCheck, AssignmentToItself) {
 	EXPECT_EQ(A["1"], Value("foo", 1));
 }
 
-TEST(AssignmentOpCheck, AssignmentToAnother1) {
-	HashTable A;
+TYPED_TEST(AssignmentOpCheck, AssignmentToAnother1) {
+	TypeParam A;
 	A.insert("0", Value("a", 2));
-	HashTable B;
+	TypeParam B;
 	B.insert("1", Value("b", 3));
 	B.insert("2", Value("b", 4));
 	A = B;
@@ -561,10 +649,10 @@ TEST(AssignmentOpCheck, AssignmentToAnother1) {
 	EXPECT_EQ(B.at("2"), Value("b", 4));
 }
 
-TEST(AssignmentOpCheck, ChangingInADoesntLeadToChangingInB) {
-	HashTable A;
+TYPED_TEST(AssignmentOpCheck, ChangingInADoesntLeadToChangingInB) {
+	TypeParam A;
 	A.insert("1", Value("1", 2));
-	HashTable B;
+	TypeParam B;
 	B = A;
 	EXPECT_EQ(B.size(), 1);
 	EXPECT_EQ(B["1"], Value("1", 2));
@@ -576,18 +664,18 @@ TEST(AssignmentOpCheck, ChangingInADoesntLeadToChangingInB) {
 }
 
 // larger tests
-TEST(LargeTests, ClearTest) {
-	HashTable A;
+TYPED_TEST(LargeTests, ClearTest) {
+	TypeParam A;
 	add_100_entries(A);
 	A.clear();
-	EXPECT_EQ(A, HashTable());
+	EXPECT_EQ(A, TypeParam());
 	many_equal_hashes(A);
 	A.clear();
-	EXPECT_EQ(A, HashTable());
+	EXPECT_EQ(A, TypeParam());
 }
 
-TEST(LargeTests, SizeCheck) {
-	HashTable A;
+TYPED_TEST(LargeTests, SizeCheck) {
+	TypeParam A;
 	add_100_entries(A);
 	EXPECT_EQ(A.size(), 100);
 	A.clear();
@@ -595,9 +683,9 @@ TEST(LargeTests, SizeCheck) {
 	EXPECT_EQ(A.size(), 100);
 }
 
-TEST(LargeTests, EqualityOpCheck) {
-	HashTable A;
-	HashTable B;
+TYPED_TEST(LargeTests, EqualityOpCheck) {
+	TypeParam A;
+	TypeParam B;
 	add_100_entries(A);
 	add_100_entries(B);
 	EXPECT_EQ(A, B);
@@ -608,10 +696,10 @@ TEST(LargeTests, EqualityOpCheck) {
 	EXPECT_EQ(A, B);
 }
 
-TEST(LargeTests, ContainsCheck) {
-	HashTable A;
+TYPED_TEST(LargeTests, ContainsCheck) {
+	TypeParam A;
 	std::vector<std::pair<Key, Value>> cells_A = add_100_entries(A);
-	HashTable B;
+	TypeParam B;
 	std::vector<std::pair<Key, Value>> cells_B = many_equal_hashes(B);
 
 	for (int i = 0; i < 99; ++i) {
@@ -622,25 +710,25 @@ TEST(LargeTests, ContainsCheck) {
 	}
 }
 
-TEST(LargeTests, EraseCheck) {
-	HashTable A;
+TYPED_TEST(LargeTests, EraseCheck) {
+	TypeParam A;
 	std::vector<std::pair<Key, Value>> cells = add_100_entries(A);
 	for (int i = 0; i < 100; ++i) {
 		A.erase(cells[i].first);
 	}
-	EXPECT_EQ(A, HashTable());
+	EXPECT_EQ(A, TypeParam());
 	A.clear();
 	cells = many_equal_hashes(A);
 	for (int i = 0; i < 100; ++i) {
 		A.erase(cells[i].first);
 	}
-	EXPECT_EQ(A, HashTable());
+	EXPECT_EQ(A, TypeParam());
 }
 
-TEST(LargeTests, AssignmentOp) {
-	HashTable A;
+TYPED_TEST(LargeTests, AssignmentOp) {
+	TypeParam A;
 	add_100_entries(A);
-	HashTable B;
+	TypeParam B;
 	B = A;
 	EXPECT_EQ(A, B);
 	A.clear();
@@ -648,3 +736,1057 @@ TEST(LargeTests, AssignmentOp) {
 	B = A;
 	EXPECT_EQ(A, B);
 }
+
+// reserve check
+TYPED_TEST(ReserveCheck, KeepsContent) {
+	TypeParam A;
+	std::vector<std::pair<Key, Value>> cells = add_100_entries(A);
+	A.reserve(10000);
+	EXPECT_EQ(A.size(), 100);
+	for (const auto& [key, val] : cells)
+		EXPECT_EQ(A.at(key), val);
+}
+
+TYPED_TEST(ReserveCheck, ReserveEmptyHT) {
+	TypeParam A;
+	A.reserve(0);
+	A.reserve(1000);
+	EXPECT_TRUE(A.empty());
+	A.insert("1", default_value);
+	EXPECT_TRUE(A.contains("1"));
+}
+
+// chain stats check
+TEST(ChainStatsCheck, EqualHashesShareBucket) {
+	HashTable A;
+	HashTable::ChainStats empty = A.chain_stats();
+	EXPECT_EQ(empty.used_buckets, 0);
+	EXPECT_EQ(empty.compares_per_hit, 0);
+	many_equal_hashes(A);
+	HashTable::ChainStats stats = A.chain_stats();
+	EXPECT_EQ(stats.used_buckets, 1);
+	EXPECT_EQ(stats.longest, 100);
+	EXPECT_DOUBLE_EQ(stats.compares_per_hit, 50.5);
+	EXPECT_GE(stats.buckets, 200);
+}
+
+// parallel rehash check
+TEST(ParallelRehashCheck, ExpandAndReduce) {
+	HashTable A;
+	A.set_parallel_rehash(1, 4);
+	std::vector<std::pair<Key, Value>> cells = add_100_entries(A);
+	EXPECT_EQ(A.size(), 100);
+	for (const auto& [key, val] : cells)
+		EXPECT_EQ(A.at(key), val);
+	for (int i = 0; i < 90; ++i)
+		A.erase(cells[i].first);
+	EXPECT_EQ(A.size(), 10);
+	for (int i = 90; i < 100; ++i)
+		EXPECT_EQ(A.at(cells[i].first), cells[i].second);
+}
+
+TEST(ParallelRehashCheck, SameAsSequential) {
+	HashTable A;
+	HashTable B;
+	A.set_parallel_rehash(1, 3);
+	B.set_parallel_rehash(0);
+	many_equal_hashes(A);
+	many_equal_hashes(B);
+	A.reserve(5000);
+	EXPECT_EQ(A, B);
+}
+
+// merge check
+TEST(MergeCheck, MergeDisjoint) {
+	HashTable A;
+	HashTable B;
+	std::vector<std::pair<Key, Value>> cells = add_100_entries(A);
+	std::vector<std::pair<Key, Value>> other_cells = many_equal_hashes(B);
+	A.merge(std::move(B));
+	EXPECT_EQ(A.size(), 200);
+	EXPECT_TRUE(B.empty());
+	for (const auto& [key, val] : cells)
+		EXPECT_EQ(A.at(key), val);
+	for (const auto& [key, val] : other_cells)
+		EXPECT_EQ(A.at(key), val);
+}
+
+TEST(MergeCheck, SameKeyTakesValueFromMerged) {
+	HashTable A;
+	A.insert("1", default_value);
+	A.insert("2", Value("a", 2));
+	HashTable B;
+	B.insert("2", Value("b", 3));
+	B.insert("3", Value("c", 4));
+	A.merge(std::move(B));
+	EXPECT_EQ(A.size(), 3);
+	EXPECT_EQ(A.at("1"), default_value);
+	EXPECT_EQ(A.at("2"), Value("b", 3));
+	EXPECT_EQ(A.at("3"), Value("c", 4));
+	EXPECT_EQ(B, HashTable());
+}
+
+TEST(MergeCheck, MergeWithItselfAndEmpty) {
+	HashTable A;
+	add_100_entries(A);
+	HashTable B = A;
+	A.merge(std::move(A));
+	EXPECT_EQ(A, B);
+	A.merge(HashTable());
+	EXPECT_EQ(A, B);
+}
+
+TEST(MergeCheck, CellsAreNotCopied) {
+	HashTable A, B;
+	add_100_entries(A);
+	for (int i = 0; i < 1000; ++i)
+		B.insert("b" + std::to_string(i), Value("b", i));
+	const Value* a = &A.at("1");
+	const Value* b = &B.at("b1");
+	A.merge(std::move(B));
+	EXPECT_EQ(&A.at("1"), a);
+	EXPECT_EQ(&A.at("b1"), b);
+	A.reserve(100000);
+	EXPECT_EQ(&A.at("1"), a);
+}
+
+// build_from check
+TEST(BuildFromCheck, SameAsInsert) {
+	HashTable A;
+	std::vector<std::pair<Key, Value>> cells = add_100_entries(A);
+	std::vector<std::pair<Key, Value>> other_cells = many_equal_hashes(A);
+	cells.insert(cells.end(), other_cells.begin(), other_cells.end());
+	for (size_t threads : { 1, 2, 5 }) {
+		HashTable B = HashTable::build_from(cells, threads);
+		EXPECT_EQ(B.size(), 200);
+		EXPECT_EQ(A, B);
+	}
+}
+
+TEST(BuildFromCheck, LastDuplicateWins) {
+	std::vector<std::pair<Key, Value>> cells = { { "1", Value("a", 1) }, { "2", default_value }, { "1", Value("b", 2) } };
+	HashTable A = HashTable::build_from(cells, 2);
+	EXPECT_EQ(A.size(), 2);
+	EXPECT_EQ(A.at("1"), Value("b", 2));
+	A.insert("3", default_value);
+	EXPECT_TRUE(A.contains("3"));
+	EXPECT_TRUE(HashTable::build_from({}).empty());
+}
+
+// eviction check
+TEST(EvictionCheck, SizeNeverExceedsCapacity) {
+	HashTable A;
+	A.set_capacity(10);
+	std::vector<std::pair<Key, Value>> cells = add_100_entries(A);
+	EXPECT_EQ(A.size(), 10);
+	EXPECT_TRUE(A.contains(cells.back().first));
+	size_t found = 0;
+	for (const auto& [key, val] : cells) {
+		if (A.contains(key)) {
+			EXPECT_EQ(A.at(key), val);
+			++found;
+		}
+	}
+	EXPECT_EQ(found, 10);
+}
+
+TEST(EvictionCheck, UsedCellSurvives) {
+	HashTable A;
+	A.set_capacity(3);
+	A.insert("1", default_value);
+	A.insert("2", default_value);
+	A.insert("3", default_value);
+	for (int i = 4; i <= 20; ++i) {
+		EXPECT_TRUE(A.contains("1"));
+		A.insert(std::to_string(i), default_value);
+		EXPECT_EQ(A.size(), 3);
+	}
+	EXPECT_TRUE(A.contains("1"));
+}
+
+TEST(EvictionCheck, CallbackGetsEvictedCells) {
+	HashTable A;
+	std::vector<std::pair<Key, Value>> evicted;
+	A.set_eviction_callback([&evicted](const Key& k, const Value& v) { evicted.emplace_back(k, v); });
+	A.set_capacity(5);
+	std::vector<std::pair<Key, Value>> cells = add_100_entries(A);
+	EXPECT_EQ(evicted.size(), 95);
+	for (const auto& [key, val] : evicted) {
+		EXPECT_FALSE(A.contains(key));
+		EXPECT_EQ(val, Value("name" + key, std::stoi(key)));
+	}
+	A.erase(cells.back().first);
+	EXPECT_EQ(evicted.size(), 95);
+}
+
+TEST(EvictionCheck, BytesCapacity) {
+	HashTable A;
+	A.insert("1", default_value);
+	A.set_capacity(0, 1);
+	EXPECT_EQ(A.size(), 0);
+	A.insert("3", default_value);
+	A.insert("2", default_value);
+	EXPECT_EQ(A.size(), 1);
+	EXPECT_TRUE(A.contains("2"));
+	size_t cell_bytes = A.bytes();
+	A.set_capacity(0, 4 * cell_bytes);
+	add_100_entries(A);
+	EXPECT_LE(A.bytes(), 4 * cell_bytes);
+	EXPECT_GE(A.size(), 2);
+	A.set_capacity(0);
+	add_100_entries(A);
+	EXPECT_EQ(A.size(), 100);
+}
+
+TEST(EvictionCheck, ShrinkingCapacityEvicts) {
+	HashTable A;
+	add_100_entries(A);
+	A["a"] = Value("b", 1);
+	A.set_capacity(7);
+	EXPECT_EQ(A.size(), 7);
+	A.clear();
+	EXPECT_EQ(A.bytes(), 0);
+	add_100_entries(A);
+	EXPECT_EQ(A.size(), 7);
+}
+
+TEST(EvictionCheck, BulkEvictionShrinksStorage) {
+	HashTable A, B;
+	for (int i = 0; i < 10000; ++i)
+		A.insert(std::to_string(i), default_value);
+	B = A;
+	size_t buckets = A.chain_stats().buckets;
+	A.set_capacity(10);
+	EXPECT_EQ(A.size(), 10);
+	EXPECT_LT(A.chain_stats().buckets, buckets / 100);
+	for (int i = 0; i < 1000; ++i)
+		A.insert("new" + std::to_string(i), default_value);
+	EXPECT_EQ(A.size(), 10);
+	EXPECT_TRUE(A.contains("new999"));
+
+	HashTable C;
+	C.set_capacity(10);
+	C.merge(std::move(B));
+	EXPECT_EQ(C.size(), 10);
+	EXPECT_LT(C.chain_stats().buckets, buckets / 100);
+}
+
+// expiry check
+TEST(ExpiryCheck, ExpiredCellIsAbsent) {
+	HashTable A;
+	EXPECT_TRUE(A.insert("1", Value("a", 1), std::chrono::seconds(0)));
+	EXPECT_TRUE(A.insert("2", Value("b", 2), std::chrono::hours(1)));
+	EXPECT_FALSE(A.contains("1"));
+	EXPECT_THROW(A.at("1"), std::out_of_range);
+	const HashTable& C = A;
+	EXPECT_THROW(C.at("1"), std::out_of_range);
+	EXPECT_TRUE(A.contains("2"));
+	EXPECT_EQ(A.at("2"), Value("b", 2));
+}
+
+TEST(ExpiryCheck, ReclaimedByKeyOperations) {
+	HashTable A;
+	A.insert("1", Value("a", 1), std::chrono::seconds(0));
+	A.insert("2", Value("b", 2), std::chrono::seconds(0));
+	A.insert("3", Value("c", 3), std::chrono::seconds(0));
+	EXPECT_EQ(A.size(), 3);
+	EXPECT_EQ(A["1"], default_value);
+	EXPECT_EQ(A.size(), 3);
+	EXPECT_FALSE(A.erase("2"));
+	EXPECT_EQ(A.size(), 2);
+	EXPECT_TRUE(A.insert("3", Value("d", 4)));
+	EXPECT_EQ(A.size(), 2);
+	EXPECT_EQ(A.at("3"), Value("d", 4));
+}
+
+TEST(ExpiryCheck, PlainInsertRemovesTTL) {
+	HashTable A;
+	A.insert("1", Value("a", 1), std::chrono::seconds(0));
+	A.insert("2", Value("b", 2), std::chrono::hours(1));
+	EXPECT_FALSE(A.insert("2", Value("c", 3)));
+	A.insert("2", Value("c", 3), std::chrono::seconds(0));
+	A.insert("2", Value("d", 4));
+	EXPECT_EQ(A.expire_some(100), 1);
+	EXPECT_EQ(A.at("2"), Value("d", 4));
+}
+
+TEST(ExpiryCheck, IncrementalExpiry) {
+	HashTable A;
+	std::vector<std::pair<Key, Value>> cells = add_100_entries(A);
+	for (int i = 0; i < 50; ++i)
+		A.insert(cells[i].first, cells[i].second, std::chrono::seconds(0));
+	A.insert("long", default_value, std::chrono::hours(1));
+	EXPECT_EQ(A.expire_some(0), 0);
+	size_t removed = 0;
+	size_t calls = 0;
+	while (A.size() > 51) {
+		removed += A.expire_some(8);
+		++calls;
+		ASSERT_LE(calls, 1000);
+	}
+	EXPECT_EQ(removed, 50);
+	EXPECT_GT(calls, 1);
+	EXPECT_EQ(A.expire_some(1000), 0);
+	for (int i = 50; i < 100; ++i)
+		EXPECT_EQ(A.at(cells[i].first), cells[i].second);
+	EXPECT_TRUE(A.contains("long"));
+}
+
+TEST(ExpiryCheck, IncrementalExpiryKeepsStorage) {
+	HashTable A;
+	for (int i = 0; i < 1000; ++i)
+		A.insert(std::to_string(i), default_value, std::chrono::seconds(0));
+	A.insert("long", default_value, std::chrono::hours(1));
+	size_t buckets = A.chain_stats().buckets;
+	size_t calls = 0;
+	while (A.size() > 1) {
+		A.expire_some(64);
+		EXPECT_EQ(A.chain_stats().buckets, buckets);
+		++calls;
+		ASSERT_LE(calls, 1000);
+	}
+	A.insert("short", default_value);
+	A.erase("short");
+	EXPECT_LT(A.chain_stats().buckets, buckets);
+	EXPECT_TRUE(A.contains("long"));
+}
+
+TEST(ExpiryCheck, NoTTLNothingExpires) {
+	HashTable A;
+	add_100_entries(A);
+	EXPECT_EQ(A.expire_some(1000), 0);
+	EXPECT_EQ(A.size(), 100);
+}
+
+TEST(ExpiryCheck, ExtremeTTL) {
+	HashTable A;
+	A.insert("hours", default_value, std::chrono::hours::max());
+	A.insert("clock", default_value, HashTable::Clock::duration::max());
+	A.insert("negative", default_value, std::chrono::hours::min());
+	A.insert("zero", default_value, HashTable::Clock::duration(-1));
+	EXPECT_TRUE(A.contains("hours"));
+	EXPECT_TRUE(A.contains("clock"));
+	EXPECT_FALSE(A.contains("negative"));
+	EXPECT_FALSE(A.contains("zero"));
+	EXPECT_EQ(A.expire_some(100), 2);
+	EXPECT_EQ(A.size(), 2);
+}
+
+// range_by_age check
+TEST(AgeIndexCheck, SameWithAndWithoutIndex) {
+	HashTable A;
+	add_100_entries(A);
+	HashTable B = A;
+	B.set_age_index(true);
+	for (unsigned int a : { 0, 1, 10, 50, 99, 100, 101 }) {
+		for (unsigned int b : { 0, 1, 10, 50, 99, 100, 200 }) {
+			std::vector<Key> keys = A.range_by_age(a, b);
+			EXPECT_EQ(keys, B.range_by_age(a, b));
+			EXPECT_EQ(keys.size(), a > b ? 0 : std::min(b, 100u) - std::min(std::max(a, 1u), 101u) + 1);
+		}
+	}
+	EXPECT_EQ(B.range_by_age(5, 7), std::vector<Key>({ "5", "6", "7" }));
+}
+
+TEST(AgeIndexCheck, FollowsChanges) {
+	HashTable A;
+	A.set_age_index(true);
+	std::vector<std::pair<Key, Value>> cells = add_100_entries(A);
+	EXPECT_EQ(A.range_by_age(10, 10), std::vector<Key>({ "10" }));
+	A.erase("10");
+	EXPECT_TRUE(A.range_by_age(10, 10).empty());
+	A.insert("a", Value("a", 10));
+	EXPECT_EQ(A.range_by_age(10, 10), std::vector<Key>({ "a" }));
+	A["a"].age = 11;
+	EXPECT_EQ(A.range_by_age(10, 11), std::vector<Key>({ "11", "a" }));
+	A.at("11") = Value("b", 1000);
+	EXPECT_EQ(A.range_by_age(10, 11), std::vector<Key>({ "a" }));
+	A["b"];
+	EXPECT_EQ(A.range_by_age(0, 0), std::vector<Key>({ "b" }));
+	A.clear();
+	EXPECT_TRUE(A.range_by_age(0, 1000).empty());
+	A.insert("c", Value("c", 3));
+	EXPECT_EQ(A.range_by_age(0, 1000), std::vector<Key>({ "c" }));
+}
+
+TEST(AgeIndexCheck, SkipsExpiredAndEvicted) {
+	HashTable A;
+	A.set_age_index(true);
+	A.insert("1", Value("a", 1), std::chrono::seconds(0));
+	A.insert("2", Value("b", 1));
+	EXPECT_EQ(A.range_by_age(1, 1), std::vector<Key>({ "2" }));
+	A.set_capacity(1);
+	EXPECT_EQ(A.range_by_age(0, 10).size(), 1);
+}
+
+TEST(AgeIndexCheck, ReindexesTouchedKeys) {
+	HashTable A;
+	A.set_age_index(true);
+	add_100_entries(A);
+	A["5"].age = 200;
+	A["5"].age = 201;
+	A.at("6").age = 202;
+	A.at("7").age = 203;
+	A.erase("7");
+	A["8"].age = 204;
+	A.insert("8", Value("c", 8));
+	A["new"].age = 205;
+	EXPECT_EQ(A.range_by_age(5, 8), std::vector<Key>({ "8" }));
+	EXPECT_EQ(A.range_by_age(200, 300), std::vector<Key>({ "5", "6", "new" }));
+	A["5"].age = 5;
+	EXPECT_EQ(A.range_by_age(5, 5), std::vector<Key>({ "5" }));
+	EXPECT_EQ(A.range_by_age(200, 300), std::vector<Key>({ "6", "new" }));
+}
+
+TEST(AgeIndexCheck, SameAsScanAfterRandomChanges) {
+	HashTable A, B;
+	B.set_age_index(true);
+	std::mt19937 gen(30);
+	for (int i = 0; i < 20000; ++i) {
+		Key k = std::to_string(gen() % 500);
+		unsigned int age = gen() % 100;
+		switch (gen() % 5) {
+		case 0:
+			A.erase(k);
+			B.erase(k);
+			break;
+		case 1:
+			A[k].age = age;
+			B[k].age = age;
+			break;
+		case 2:
+			if (A.contains(k)) {
+				A.at(k).age = age;
+				B.at(k).age = age;
+			}
+			break;
+		default:
+			A.insert(k, Value(k, age));
+			B.insert(k, Value(k, age));
+		}
+		if (i % 100 == 0) {
+			unsigned int a = gen() % 100;
+			EXPECT_EQ(A.range_by_age(a, a + 10), B.range_by_age(a, a + 10));
+		}
+	}
+	HashTable C;
+	C.insert("0", Value("merged", 1000));
+	C.insert("merged", Value("merged", 1000));
+	B.merge(std::move(C));
+	EXPECT_EQ(B.range_by_age(1000, 1000), std::vector<Key>({ "0", "merged" }));
+	EXPECT_EQ(B.range_by_age(0, 99).size(), A.size() - (A.contains("0") ? 1 : 0));
+}
+
+// frozen HT check
+TEST(FrozenCheck, ContainsAllKeys) {
+	HashTable A;
+	std::vector<std::pair<Key, Value>> cells = add_100_entries(A);
+	std::vector<std::pair<Key, Value>> other_cells = many_equal_hashes(A);
+	const FrozenHashTable F(A);
+	EXPECT_EQ(F.size(), 200);
+	EXPECT_FALSE(F.empty());
+	for (const auto& [key, val] : cells)
+		EXPECT_EQ(F.at(key), val);
+	for (const auto& [key, val] : other_cells)
+		EXPECT_EQ(F.at(key), val);
+	EXPECT_FALSE(F.contains("0"));
+	EXPECT_FALSE(F.contains(""));
+	EXPECT_THROW(F.at("101"), std::out_of_range);
+}
+
+TEST(FrozenCheck, EmptyAndSingle) {
+	HashTable A;
+	FrozenHashTable F(A);
+	EXPECT_TRUE(F.empty());
+	EXPECT_FALSE(F.contains("1"));
+	EXPECT_THROW(F.at("1"), std::out_of_range);
+	A.insert("1", Value("a", 1));
+	FrozenHashTable G(A);
+	EXPECT_EQ(G.size(), 1);
+	EXPECT_EQ(G.at("1"), Value("a", 1));
+	EXPECT_FALSE(G.contains("2"));
+}
+
+TEST(FrozenCheck, DoesntFollowChanges) {
+	HashTable A;
+	A.insert("1", Value("a", 1));
+	A.insert("2", Value("b", 2), std::chrono::seconds(0));
+	FrozenHashTable F(A);
+	A.erase("1");
+	A.insert("3", default_value);
+	EXPECT_EQ(F.size(), 1);
+	EXPECT_EQ(F.at("1"), Value("a", 1));
+	EXPECT_FALSE(F.contains("2"));
+	EXPECT_FALSE(F.contains("3"));
+}
+
+TEST(FrozenCheck, ManyKeys) {
+	HashTable A;
+	for (int i = 0; i < 20000; ++i)
+		A.insert("key" + std::to_string(i), Value("name", i));
+	FrozenHashTable F(A);
+	EXPECT_EQ(F.size(), 20000);
+	for (int i = 0; i < 20000; ++i)
+		EXPECT_EQ(F.at("key" + std::to_string(i)).age, i);
+	EXPECT_FALSE(F.contains("key20000"));
+	// frozen HT has neither empty buckets nor list nodes
+	EXPECT_LT(F.memory_usage(), A.memory_usage());
+	EXPECT_GT(F.memory_usage(), 20000 * (sizeof(Key) + sizeof(Value)));
+}
+
+// filter check
+TEST(FilterCheck, LookupsWithFilter) {
+	HashTable A;
+	A.set_filter(0.01);
+	std::vector<std::pair<Key, Value>> cells = add_100_entries(A);
+	std::vector<std::pair<Key, Value>> other_cells = many_equal_hashes(A);
+	for (const auto& [key, val] : cells)
+		EXPECT_EQ(A.at(key), val);
+	for (const auto& [key, val] : other_cells)
+		EXPECT_TRUE(A.contains(key));
+	for (int i = 101; i < 1000; ++i)
+		EXPECT_FALSE(A.contains(std::to_string(i)));
+	for (int i = 0; i < 90; ++i)
+		EXPECT_TRUE(A.erase(cells[i].first));
+	for (int i = 0; i < 90; ++i)
+		EXPECT_FALSE(A.contains(cells[i].first));
+	for (int i = 90; i < 100; ++i)
+		EXPECT_EQ(A.at(cells[i].first), cells[i].second);
+	A.clear();
+	EXPECT_FALSE(A.contains(cells[95].first));
+	A["1"];
+	EXPECT_TRUE(A.contains("1"));
+}
+
+TEST(FilterCheck, FollowsEvictionMergeAndCopy) {
+	HashTable A;
+	A.set_filter(0.05);
+	A.set_capacity(10);
+	add_100_entries(A);
+	size_t found = 0;
+	for (int i = 1; i <= 100; ++i)
+		found += A.contains(std::to_string(i));
+	EXPECT_EQ(found, 10);
+	A.set_capacity(0);
+	HashTable B;
+	std::vector<std::pair<Key, Value>> cells = many_equal_hashes(B);
+	A.merge(std::move(B));
+	for (const auto& [key, val] : cells)
+		EXPECT_EQ(A.at(key), val);
+	HashTable C = A;
+	EXPECT_EQ(A, C);
+	C.set_filter(0);
+	EXPECT_EQ(A, C);
+}
+
+TEST(FilterCheck, FalsePositiveRate) {
+	for (double fp_rate : { 0.1, 0.01 }) {
+		CountingBloomFilter F(10000, fp_rate);
+		for (int i = 0; i < 10000; ++i)
+			F.add(calc_key_hash(std::to_string(i)));
+		for (int i = 0; i < 10000; ++i)
+			EXPECT_TRUE(F.may_contain(calc_key_hash(std::to_string(i))));
+		size_t false_positives = 0;
+		for (int i = 10000; i < 110000; ++i)
+			false_positives += F.may_contain(calc_key_hash(std::to_string(i)));
+		EXPECT_LT(false_positives / 100000.0, 2 * fp_rate);
+		for (int i = 0; i < 10000; ++i)
+			F.remove(calc_key_hash(std::to_string(i)));
+		false_positives = 0;
+		for (int i = 0; i < 110000; ++i)
+			false_positives += F.may_contain(calc_key_hash(std::to_string(i)));
+		EXPECT_EQ(false_positives, 0);
+	}
+}
+
+// trace check
+TEST(TraceCheck, WriteAndRead) {
+	std::stringstream ss;
+	TraceWriter writer(ss);
+	writer.write(TraceOp::INSERT, "key", Value("name", 300));
+	writer.write(TraceOp::INSERT_TTL, std::string(200, 'k'), Value("", 0), std::chrono::seconds(5));
+	writer.write(TraceOp::CONTAINS, "");
+	writer.write(TraceOp::CLEAR, "ignored");
+
+	TraceReader reader(ss);
+	TraceOp op;
+	ASSERT_TRUE(reader.read(op));
+	EXPECT_EQ(op.type, TraceOp::INSERT);
+	EXPECT_EQ(op.key, "key");
+	EXPECT_EQ(Value(op.name, op.age), Value("name", 300));
+	ASSERT_TRUE(reader.read(op));
+	EXPECT_EQ(op.type, TraceOp::INSERT_TTL);
+	EXPECT_EQ(op.key, std::string(200, 'k'));
+	EXPECT_EQ(op.ttl, std::chrono::seconds(5));
+	ASSERT_TRUE(reader.read(op));
+	EXPECT_EQ(op.type, TraceOp::CONTAINS);
+	EXPECT_EQ(op.key, "");
+	ASSERT_TRUE(reader.read(op));
+	EXPECT_EQ(op.type, TraceOp::CLEAR);
+	EXPECT_FALSE(reader.read(op));
+}
+
+TEST(TraceCheck, BrokenTraces) {
+	std::stringstream not_trace("abcd");
+	EXPECT_THROW(TraceReader reader(not_trace), std::runtime_error);
+	std::stringstream ss;
+	TraceWriter writer(ss);
+	writer.write(TraceOp::INSERT, "key", Value("name", 1));
+	std::string data = ss.str();
+	std::stringstream truncated(data.substr(0, data.size() - 2));
+	TraceReader reader(truncated);
+	TraceOp op;
+	EXPECT_THROW(reader.read(op), std::runtime_error);
+}
+
+TEST(TraceCheck, RecordsEveryCallOnce) {
+	std::stringstream ss;
+	TraceWriter writer(ss);
+	HashTable A;
+	A.set_trace(&writer);
+	A.insert("1", Value("a", 1));
+	A.insert("2", Value("b", 2), std::chrono::seconds(0));
+	A.contains("2");
+	A["2"];
+	A.at("1");
+	EXPECT_THROW(std::as_const(A).at("3"), std::out_of_range);
+	A.erase("1");
+	A.clear();
+	HashTable B = A;
+	B.insert("3", default_value);
+	A.set_trace(nullptr);
+	A.insert("4", default_value);
+
+	std::vector<TraceOp::Type> expected = { TraceOp::INSERT, TraceOp::INSERT_TTL, TraceOp::CONTAINS, TraceOp::SUBSCRIPT,
+		TraceOp::AT, TraceOp::AT, TraceOp::ERASE, TraceOp::CLEAR };
+	std::vector<Key> keys = { "1", "2", "2", "2", "1", "3", "1", "" };
+	TraceReader reader(ss);
+	TraceOp op;
+	for (size_t i = 0; i < expected.size(); ++i) {
+		ASSERT_TRUE(reader.read(op));
+		EXPECT_EQ(op.type, expected[i]);
+		EXPECT_EQ(op.key, keys[i]);
+	}
+	EXPECT_FALSE(reader.read(op));
+}
+
+// find_interleaved check
+TEST(InterleavedLookupCheck, SameAsContains) {
+	HashTable A;
+	std::vector<std::pair<Key, Value>> cells = add_100_entries(A);
+	std::vector<std::pair<Key, Value>> other_cells = many_equal_hashes(A);
+	std::vector<Key> keys;
+	for (int i = 0; i < 300; ++i)
+		keys.push_back(std::to_string(i));
+	for (const auto& [key, val] : other_cells)
+		keys.push_back(key);
+	for (size_t group_size : { 0, 1, 3, 16, 1000 }) {
+		std::vector<const Value*> found = A.find_interleaved(keys, group_size);
+		ASSERT_EQ(found.size(), keys.size());
+		for (size_t i = 0; i < keys.size(); ++i) {
+			if (A.contains(keys[i]))
+				EXPECT_EQ(found[i], &A.at(keys[i]));
+			else
+				EXPECT_EQ(found[i], nullptr);
+		}
+	}
+	EXPECT_TRUE(A.find_interleaved({}, 4).empty());
+}
+
+TEST(InterleavedLookupCheck, SkipsExpiredAndFiltered) {
+	HashTable A;
+	A.set_filter(0.01);
+	A.insert("1", Value("a", 1));
+	A.insert("2", Value("b", 2), std::chrono::seconds(0));
+	std::vector<const Value*> found = A.find_interleaved({ "1", "2", "3" }, 2);
+	EXPECT_EQ(*found[0], Value("a", 1));
+	EXPECT_EQ(found[1], nullptr);
+	EXPECT_EQ(found[2], nullptr);
+}
+
+// memory policy check
+TEST(MemoryPolicyCheck, LargeArrays) {
+	size_t before = large_array_bytes();
+	for (bool huge_pages : { false, true }) {
+		MemoryPolicy policy;
+		policy.huge_pages = huge_pages;
+		policy.interleave = huge_pages;
+		set_memory_policy(policy);
+		EXPECT_EQ(memory_policy().huge_pages, huge_pages);
+		{
+			std::vector<uint64_t, LargeArrayAllocator<uint64_t>> small(100, 1);
+			EXPECT_EQ(large_array_bytes(), before);
+			std::vector<uint64_t, LargeArrayAllocator<uint64_t>> large(LARGE_ARRAY_BYTES / 8 + 1, 1);
+			EXPECT_EQ(reinterpret_cast<uintptr_t>(large.data()) % LARGE_ARRAY_BYTES, 0);
+			EXPECT_GE(large_array_bytes(), before + LARGE_ARRAY_BYTES + 8);
+			EXPECT_EQ(large.back() + small.back(), 2);
+		}
+		EXPECT_EQ(large_array_bytes(), before);
+	}
+	set_memory_policy(MemoryPolicy());
+}
+
+TEST(MemoryPolicyCheck, HTWithLargeStorage) {
+	MemoryPolicy policy;
+	policy.huge_pages = true;
+	set_memory_policy(policy);
+	size_t before = large_array_bytes();
+	{
+		HashTable A;
+		std::vector<std::pair<Key, Value>> cells = add_100_entries(A);
+		A.reserve(LARGE_ARRAY_BYTES / sizeof(void*));
+		EXPECT_GT(large_array_bytes(), before);
+		HashTable B = A;
+		for (const auto& [key, val] : cells)
+			EXPECT_EQ(B.at(key), val);
+		B.clear();
+		A.swap(B);
+		EXPECT_TRUE(A.empty());
+		EXPECT_EQ(B.size(), 100);
+	}
+	EXPECT_EQ(large_array_bytes(), before);
+	set_memory_policy(MemoryPolicy());
+}
+
+// spill HT check
+// every test gets its own file, since ctest may run the tests in parallel
+std::string spill_path() {
+	std::string name = ::testing::UnitTest::GetInstance()->current_test_info()->name();
+	return (std::filesystem::temp_directory_path() / ("spill_check_" + name + ".bin")).string();
+}
+
+TEST(SpillCheck, SameAsHT) {
+	SpillHashTable S(spill_path(), 4 << 10, 16);
+	HashTable A;
+	for (size_t i = 0; i < 2000; ++i) {
+		Key key = "key" + std::to_string(i);
+		Value val("name" + std::to_string(i), i);
+		EXPECT_EQ(S.insert(key, val), A.insert(key, val));
+		if (i % 3 == 0) {
+			Key old = "key" + std::to_string(i / 2);
+			EXPECT_EQ(S.erase(old), A.erase(old));
+		}
+	}
+	EXPECT_EQ(S.size(), A.size());
+	EXPECT_GT(S.stats().writes, 0);
+	EXPECT_GT(S.stats().reads, 0);
+	for (size_t i = 0; i < 2100; ++i) {
+		Key key = "key" + std::to_string(i);
+		EXPECT_EQ(S.contains(key), A.contains(key));
+		if (A.contains(key))
+			EXPECT_EQ(S.at(key), A.at(key));
+		else
+			EXPECT_THROW(S.at(key), std::out_of_range);
+	}
+}
+
+TEST(SpillCheck, StaysInBudget) {
+	SpillHashTable S(spill_path(), 64 << 10, 64);
+	for (size_t i = 0; i < 5000; ++i)
+		S.insert("key" + std::to_string(i), Value("name", i));
+	EXPECT_LE(S.resident_bytes(), 80 << 10);
+	EXPECT_EQ(S.size(), 5000);
+
+	// once the changed partitions are written, reading doesn't write anything
+	for (size_t i = 0; i < 5000; ++i)
+		EXPECT_EQ(S.at("key" + std::to_string(i)).age, i);
+	SpillHashTable::Stats before = S.stats();
+	for (size_t i = 0; i < 5000; ++i)
+		EXPECT_EQ(S.at("key" + std::to_string(i)).age, i);
+	EXPECT_EQ(S.stats().writes, before.writes);
+	EXPECT_GT(S.stats().reads, before.reads);
+}
+
+TEST(SpillCheck, Compaction) {
+	{
+		SpillHashTable S(spill_path(), 1 << 10, 8);
+		for (size_t round = 0; round < 30; ++round)
+			for (size_t i = 0; i < 500; ++i)
+				S.insert("key" + std::to_string(i), Value(std::string(100, 'a'), round));
+		EXPECT_GT(S.stats().bytes_written, 2 << 20);
+		std::ifstream file(spill_path(), std::ios::binary | std::ios::ate);
+		EXPECT_LT(static_cast<size_t>(file.tellg()), 2 << 20);
+		for (size_t i = 0; i < 500; ++i)
+			EXPECT_EQ(S.at("key" + std::to_string(i)).age, 29);
+	}
+	EXPECT_FALSE(std::ifstream(spill_path()).good());
+}
+
+TEST(SpillCheck, BadPath) {
+	EXPECT_THROW(SpillHashTable((std::filesystem::path(spill_path()) / "no_such_dir" / "spill.bin").string(), 1 << 10), std::runtime_error);
+}
+
+// snapshot check
+TEST(SnapshotCheck, KeepsOldVersion) {
+	HashTable A;
+	std::vector<std::pair<Key, Value>> cells = add_100_entries(A);
+	HashTable::Snapshot S = A.snapshot();
+	HashTable::Snapshot E = HashTable().snapshot();
+
+	A.insert(cells[0].first, Value("changed", 1));
+	A.erase(cells[1].first);
+	A[cells[2].first].age += 1;
+	A.at(cells[3].first).name = "changed";
+	A.insert("new key", Value("new", 1));
+	A["another new key"];
+
+	EXPECT_EQ(S.size(), 100);
+	for (const auto& [key, val] : cells)
+		EXPECT_EQ(S.at(key), val);
+	EXPECT_FALSE(S.contains("new key"));
+	EXPECT_THROW(S.at("another new key"), std::out_of_range);
+	EXPECT_FALSE(A.contains(cells[1].first));
+	EXPECT_EQ(A.at(cells[0].first), Value("changed", 1));
+	EXPECT_TRUE(E.empty());
+	EXPECT_FALSE(E.contains(cells[0].first));
+}
+
+TEST(SnapshotCheck, SeveralVersions) {
+	HashTable A;
+	std::vector<HashTable::Snapshot> versions;
+	for (unsigned int v = 0; v < 5; ++v) {
+		for (size_t i = 0; i < 50; ++i)
+			A.insert("key" + std::to_string(i), Value("name", v));
+		versions.push_back(A.snapshot());
+	}
+	versions.erase(versions.begin() + 2);
+	for (size_t i = 0; i < 50; ++i)
+		A.erase("key" + std::to_string(i));
+
+	unsigned int expected[] = { 0, 1, 3, 4 };
+	for (size_t v = 0; v < versions.size(); ++v) {
+		EXPECT_EQ(versions[v].size(), 50);
+		for (size_t i = 0; i < 50; ++i)
+			EXPECT_EQ(versions[v].at("key" + std::to_string(i)).age, expected[v]);
+	}
+	EXPECT_TRUE(A.empty());
+}
+
+TEST(SnapshotCheck, WholeTableChanges) {
+	HashTable::Snapshot S = HashTable().snapshot();
+	std::vector<std::pair<Key, Value>> cells;
+	{
+		HashTable A;
+		cells = add_100_entries(A);
+		S = A.snapshot();
+		for (size_t i = 0; i < 1000; ++i)
+			A.insert("grow" + std::to_string(i), Value("name", i));
+		HashTable::Snapshot T = A.snapshot();
+		HashTable B;
+		B.insert("b", Value("b", 1));
+		A.merge(std::move(B));
+		HashTable::Snapshot U = A.snapshot();
+		A.clear();
+		EXPECT_EQ(T.size(), 1100);
+		EXPECT_TRUE(T.contains("grow999"));
+		EXPECT_FALSE(T.contains("b"));
+		EXPECT_TRUE(U.contains("b"));
+		A.insert("c", Value("c", 1));
+		S = A.snapshot();
+		A.swap(B);
+		A.insert("d", Value("d", 1));
+		EXPECT_TRUE(S.contains("c"));
+		EXPECT_FALSE(S.contains("d"));
+		S = A.snapshot();
+	}
+	EXPECT_TRUE(S.contains("d"));
+	EXPECT_EQ(S.size(), 1);
+}
+
+TEST(SnapshotCheck, EvictionAndExpiry) {
+	HashTable A;
+	A.set_capacity(10);
+	for (size_t i = 0; i < 10; ++i)
+		A.insert("key" + std::to_string(i), Value("name", i));
+	HashTable::Snapshot S = A.snapshot();
+	for (size_t i = 10; i < 20; ++i)
+		A.insert("key" + std::to_string(i), Value("name", i));
+	EXPECT_EQ(A.size(), 10);
+	for (size_t i = 0; i < 10; ++i)
+		EXPECT_TRUE(S.contains("key" + std::to_string(i)));
+
+	HashTable B;
+	B.insert("short", Value("short", 1), std::chrono::milliseconds(1));
+	B.insert("long", Value("long", 1), std::chrono::hours(1));
+	HashTable::Snapshot T = B.snapshot();
+	std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	B.expire_some(100);
+	EXPECT_FALSE(B.contains("short"));
+	EXPECT_TRUE(T.contains("short"));
+	EXPECT_TRUE(T.contains("long"));
+}
+
+// the contract of snapshot: references taken before it are taken again before writing
+TEST(SnapshotCheck, ReferencesTakenAgain) {
+	HashTable A;
+	A.insert("a", Value("a", 1));
+	A.insert("b", Value("b", 2));
+	Value& a = A["a"];
+	Value& b = A.at("b");
+	HashTable::Snapshot S = A.snapshot();
+	Value& new_a = A["a"];
+	Value& new_b = A.at("b");
+	EXPECT_EQ(&new_a, &a);
+	EXPECT_EQ(&new_b, &b);
+	new_a.age = 42;
+	new_b.age = 43;
+	EXPECT_EQ(S.at("a").age, 1);
+	EXPECT_EQ(S.at("b").age, 2);
+	EXPECT_EQ(A.at("a").age, 42);
+	EXPECT_EQ(A.at("b").age, 43);
+}
+
+TEST(SnapshotCheck, ReadWhileWriting) {
+	HashTable A;
+	for (size_t i = 0; i < 1000; ++i)
+		A.insert("key" + std::to_string(i), Value("old", i));
+	HashTable::Snapshot S = A.snapshot();
+
+	std::atomic<size_t> mismatches{ 0 };
+	std::atomic<bool> done{ false };
+	std::thread reader([&S, &mismatches, &done] {
+		while (!done) {
+			for (size_t i = 0; i < 1000; ++i) {
+				Value v = S.at("key" + std::to_string(i));
+				if ((v.name != "old") || (v.age != i))
+					++mismatches;
+			}
+		}
+	});
+	for (size_t round = 0; round < 3; ++round) {
+		for (size_t i = 0; i < 3000; ++i)
+			A.insert("key" + std::to_string(i), Value("new", round));
+		for (size_t i = 1000; i < 3000; ++i)
+			A.erase("key" + std::to_string(i));
+		S.contains("key0");
+	}
+	done = true;
+	reader.join();
+	EXPECT_EQ(mismatches, 0);
+	EXPECT_EQ(A.at("key0").name, "new");
+}
+
+// columnar HT check
+TEST(ColumnarCheck, SameAsHT) {
+	HashTable A;
+	ColumnarHashTable C;
+	std::mt19937_64 gen(42);
+	for (size_t i = 0; i < 20000; ++i) {
+		Key key = "key" + std::to_string(gen() % 3000);
+		if (gen() % 3 == 0) {
+			EXPECT_EQ(C.erase(key), A.erase(key));
+		}
+		else {
+			Value val("name" + std::to_string(i), i);
+			EXPECT_EQ(C.insert(key, val), A.insert(key, val));
+		}
+	}
+	EXPECT_EQ(C.size(), A.size());
+	for (size_t i = 0; i < 3000; ++i) {
+		Key key = "key" + std::to_string(i);
+		EXPECT_EQ(C.contains(key), A.contains(key));
+		if (A.contains(key)) {
+			EXPECT_EQ(C.at(key), A.at(key));
+			EXPECT_EQ(C.age(key), A.at(key).age);
+			EXPECT_EQ(C.name(key), A.at(key).name);
+		}
+		else {
+			EXPECT_THROW(C.age(key), std::out_of_range);
+		}
+	}
+
+	ColumnarHashTable D(A);
+	EXPECT_EQ(D.size(), A.size());
+	A.for_each([&D](const Key& k, const Value& v) { EXPECT_EQ(D.at(k), v); });
+}
+
+TEST(ColumnarCheck, Accessors) {
+	ColumnarHashTable C;
+	C.insert("a", Value("name", 1));
+	C.set_age("a", 5);
+	C.set_name("a", "other");
+	EXPECT_EQ(C.at("a"), Value("other", 5));
+	EXPECT_THROW(C.set_age("b", 1), std::out_of_range);
+	EXPECT_THROW(C.name("b"), std::out_of_range);
+	EXPECT_THROW(C.at("b"), std::out_of_range);
+	EXPECT_TRUE(ColumnarHashTable().empty());
+}
+
+TEST(ColumnarCheck, ColumnScans) {
+	HashTable A;
+	add_100_entries(A);
+	ColumnarHashTable C(A);
+	C.insert("erased", Value("erased", 50));
+	C.erase("erased");
+
+	uint64_t sum = 0;
+	A.for_each([&sum](const Key&, const Value& v) { sum += v.age; });
+	EXPECT_EQ(C.sum_ages(), sum);
+	for (auto [a, b] : std::vector<std::pair<unsigned int, unsigned int>>{ { 0, 100 }, { 10, 20 }, { 50, 50 }, { 30, 10 }, { 0, UINT_MAX } }) {
+		std::vector<Key> expected = A.range_by_age(a, b);
+		std::vector<Key> keys = C.keys_by_age(a, b);
+		EXPECT_EQ(C.count_ages(a, b), expected.size());
+		std::sort(expected.begin(), expected.end());
+		std::sort(keys.begin(), keys.end());
+		EXPECT_EQ(keys, expected);
+	}
+	for (size_t i = 0; i < 100; ++i)
+		C.insert("big" + std::to_string(i), Value("", UINT_MAX));
+	EXPECT_EQ(C.count_ages(UINT_MAX, UINT_MAX), 100);
+	EXPECT_EQ(C.sum_ages(), sum + 100ull * UINT_MAX);
+}
+
+// cuckoo HT check
+TEST(CuckooCheck, SameAsHT) {
+	for (size_t slots : { 4, 8 }) {
+		HashTable A;
+		CuckooHashTable C(slots);
+		std::mt19937_64 gen(42);
+		for (size_t i = 0; i < 10000; ++i) {
+			Key key = "key" + std::to_string(gen() % 2000);
+			if (gen() % 4 == 0) {
+				EXPECT_EQ(C.erase(key), A.erase(key));
+			}
+			else {
+				Value val("name" + std::to_string(i), i);
+				EXPECT_EQ(C.insert(key, val), A.insert(key, val));
+			}
+		}
+		EXPECT_EQ(C.size(), A.size());
+		A.for_each([&C](const Key& k, const Value& v) { EXPECT_EQ(C.at(k), v); });
+	}
+}
+
+TEST(CuckooCheck, HighLoad) {
+	for (size_t slots : { 4, 8 }) {
+		CuckooHashTable C(slots);
+		C.reserve(10000);
+		size_t capacity = C.capacity();
+		size_t n = 0;
+		for (; C.capacity() == capacity; ++n)
+			C.insert("key" + std::to_string(n), Value("name", n));
+		// the storage is doubled only when a path isn't found, which happens at a high load
+		EXPECT_GT(static_cast<double>(n - 1) / capacity, slots == 4 ? 0.9 : 0.95);
+		for (size_t i = 0; i < n; ++i)
+			EXPECT_EQ(C.at("key" + std::to_string(i)).age, i);
+		for (size_t i = 0; i < n; ++i)
+			C.erase("key" + std::to_string(i));
+		EXPECT_TRUE(C.empty());
+		EXPECT_LT(C.capacity(), capacity);
+	}
+}
+
+TEST(CuckooCheck, BucketSlots) {
+	EXPECT_THROW(CuckooHashTable(3), std::invalid_argument);
+	EXPECT_THROW(CuckooHashTable(9), std::invalid_argument);
+	CuckooHashTable A(8);
+	CuckooHashTable B;
+	add_100_entries(A);
+	add_100_entries(B);
+	EXPECT_EQ(A, B);
+	A.swap(B);
+	A.insert("1", default_value);
+	EXPECT_NE(A, B);
+	EXPECT_EQ(A.capacity() % 4, 0);
+	EXPECT_LE(A.load_factor(), 1);
+}
@@ -0,0 +1,90 @@
+#include "trace.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+	const char MAGIC[] = { 'H', 'T', 'T', '1' };
+}
+
+TraceWriter::TraceWriter(std::ostream& out) : _out(out) {
+	_out.write(MAGIC, sizeof(MAGIC));
+}
+
+void TraceWriter::write_varint(uint64_t x) {
+	while (x >= 0x80) {
+		_out.put(static_cast<char>((x & 0x7f) | 0x80));
+		x >>= 7;
+	}
+	_out.put(static_cast<char>(x));
+}
+
+void TraceWriter::write_string(const std::string& s) {
+	write_varint(s.size());
+	_out.write(s.data(), s.size());
+}
+
+void TraceWriter::write(TraceOp::Type type, const Key& k) {
+	_out.put(static_cast<char>(type));
+	if (type != TraceOp::CLEAR)
+		write_string(k);
+}
+
+void TraceWriter::write(TraceOp::Type type, const Key& k, const Value& v, std::chrono::nanoseconds ttl) {
+	write(type, k);
+	write_string(v.name);
+	write_varint(v.age);
+	if (type == TraceOp::INSERT_TTL)
+		write_varint(static_cast<uint64_t>(std::max<int64_t>(ttl.count(), 0)));
+}
+
+void TraceWriter::write(const TraceOp& op) {
+	if ((op.type == TraceOp::INSERT) || (op.type == TraceOp::INSERT_TTL))
+		write(op.type, op.key, Value(op.name, op.age), op.ttl);
+	else
+		write(op.type, op.key);
+}
+
+TraceReader::TraceReader(std::istream& in) : _in(in) {
+	char magic[sizeof(MAGIC)];
+	if (!_in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), MAGIC))
+		throw std::runtime_error("not a HashTable trace");
+}
+
+uint64_t TraceReader::read_varint() {
+	uint64_t x = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		int c = _in.get();
+		if (c == std::char_traits<char>::eof())
+			throw std::runtime_error("truncated HashTable trace");
+		x |= static_cast<uint64_t>(c & 0x7f) << shift;
+		if (!(c & 0x80))
+			return x;
+	}
+	throw std::runtime_error("corrupted HashTable trace");
+}
+
+void TraceReader::read_string(std::string& s) {
+	s.resize(read_varint());
+	if (!_in.read(s.data(), s.size()))
+		throw std::runtime_error("truncated HashTable trace");
+}
+
+bool TraceReader::read(TraceOp& op) {
+	int type = _in.get();
+	if (type == std::char_traits<char>::eof())
+		return false;
+	if (type > TraceOp::CLEAR)
+		throw std::runtime_error("corrupted HashTable trace");
+
+	op.type = static_cast<TraceOp::Type>(type);
+	op.key.clear();
+	if (op.type != TraceOp::CLEAR)
+		read_string(op.key);
+	if ((op.type == TraceOp::INSERT) || (op.type == TraceOp::INSERT_TTL)) {
+		read_string(op.name);
+		op.age = static_cast<unsigned int>(read_varint());
+	}
+	if (op.type == TraceOp::INSERT_TTL)
+		op.ttl = std::chrono::nanoseconds(read_varint());
+	return true;
+}
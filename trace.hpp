@@ -0,0 +1,50 @@
+#pragma once
+#include "hash_table.hpp"
+#include <chrono>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+
+// one recorded call of HT. val is meaningful for inserts only, ttl for INSERT_TTL only
+struct TraceOp {
+	enum Type : uint8_t { INSERT, INSERT_TTL, ERASE, CONTAINS, AT, SUBSCRIPT, CLEAR };
+
+	Type type = CLEAR;
+	Key key;
+	std::string name;
+	unsigned int age = 0;
+	std::chrono::nanoseconds ttl = std::chrono::nanoseconds(0);
+};
+
+// writes calls of HT into a binary trace: a magic header, then for every call a type byte,
+// the key and (for inserts) the value, with all lengths and numbers as varints.
+// The writer isn't synchronized, so a traced HT must be used by one thread only
+class TraceWriter {
+public:
+	explicit TraceWriter(std::ostream& out);
+
+	void write(TraceOp::Type type, const Key& k);
+	void write(TraceOp::Type type, const Key& k, const Value& v, std::chrono::nanoseconds ttl = std::chrono::nanoseconds(0));
+	void write(const TraceOp& op);
+private:
+	std::ostream& _out;
+
+	void write_varint(uint64_t x);
+	void write_string(const std::string& s);
+};
+
+// reads a trace written by TraceWriter. Throws std::runtime_error if the stream isn't a trace
+// or if it ends in the middle of a call
+class TraceReader {
+public:
+	explicit TraceReader(std::istream& in);
+
+	// returns false when the trace is over
+	bool read(TraceOp& op);
+private:
+	std::istream& _in;
+
+	uint64_t read_varint();
+	void read_string(std::string& s);
+};